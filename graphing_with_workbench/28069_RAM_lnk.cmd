@@ -161,6 +161,12 @@ SECTIONS
    DMARAML7	        : > RAML7,      PAGE = 1
    DMARAML8	        : > RAML8,      PAGE = 1   
 
+   /* Logs declared with SERIAL_LOG_REGISTER. serial_log_init walks the section
+      when the library is built with SERIAL_LOG_LINKER_TABLE */
+   serial_log_table : > RAML4,      PAGE = 1,
+                      RUN_START(_serial_log_table_start),
+                      RUN_END(_serial_log_table_end)
+
   /* Uncomment the section below if calling the IQNexp() or IQexp()
       functions from the IQMath.lib library in order to utilize the
       relevant IQ Math table in Boot ROM (This saves space and Boot ROM
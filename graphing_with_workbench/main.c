@@ -31,10 +31,18 @@ typedef struct park_currents_t {
 
 #define radians(angle) ((angle)*3.14/180.0)
 
+//all three coil currents are sampled from the same instant
+static const serial_log_field_t coil_current_fields[] = {
+    SERIAL_LOG_FIELD(coil_currents_t, a, SERIAL_LOG_FIELD_FLOAT),
+    SERIAL_LOG_FIELD(coil_currents_t, b, SERIAL_LOG_FIELD_FLOAT),
+    SERIAL_LOG_FIELD(coil_currents_t, c, SERIAL_LOG_FIELD_FLOAT)
+};
+
 //heap variables
 uint32_t log_memory[3000];
 int amplitude;
 int frequency;
+volatile float rotor_position = 0.0;
 
 /*
  * Callback function when the knob for frequency is adjusted
@@ -93,6 +101,37 @@ park_currents_t park_transformation(volatile clarke_currents_t *clarke, float an
     return park;
 }
 
+/*
+ * Computes the clarke currents of the logged coil currents. It is only
+ * called when the Clarke Transformation log stores a sample
+ */
+void clarke_log_values(const float *coil_values, float *clarke_values, void *context)
+{
+    coil_currents_t current;
+    clarke_currents_t clarke;
+    current.a = coil_values[0];
+    current.b = coil_values[1];
+    current.c = coil_values[2];
+    clarke = clarke_transformation(&current);
+    clarke_values[0] = clarke.alpha;
+    clarke_values[1] = clarke.beta;
+}
+
+/*
+ * Computes the park currents of the logged clarke currents at the rotor
+ * position that context points to
+ */
+void park_log_values(const float *clarke_values, float *park_values, void *context)
+{
+    clarke_currents_t clarke;
+    park_currents_t park;
+    clarke.alpha = clarke_values[0];
+    clarke.beta = clarke_values[1];
+    park = park_transformation(&clarke, *(volatile float *)context);
+    park_values[0] = park.direct;
+    park_values[1] = park.quadrature;
+}
+
 __interrupt void commutation_timer_isr(void)
 {
     serial_log_sample_data();
@@ -130,11 +169,8 @@ void init_commutation_timer()
 int main(void)
 {
     uint32_t prev_current_time = 0;
-    float rotor_position = 0.0;
-    //void *log_clarke, *log_park, *log_currents;
+    void *log_clarke, *log_currents;
     volatile coil_currents_t current;
-    volatile clarke_currents_t clarke;
-    volatile park_currents_t park;
     //volatile float current_a, current_b, current_c;
     //volatile float alpha, beta;
     //volatile float direct, quadrature;
@@ -144,22 +180,24 @@ int main(void)
     InitCpuTimers();
 
     serial_log_init(log_memory, sizeof(log_memory), 1000);
-    if(serial_log_output("Coil Currents", 300, 3, "A", &current.a, "B", &current.b, "C", &current.c) == NULL)
+    //the commutation frequency is at most 30Hz so 100Hz of bandwidth leaves room for the derived logs
+    log_currents = serial_log_output_struct("Coil Currents", 100, &current, sizeof(current), 3, coil_current_fields);
+    if(log_currents == NULL)
     {
         return 1;
     }
 
-    /*log_clarke = serial_log_output("Clarke Transformation", 300, 2, "alpha", &clarke.alpha, "beta", &clarke.beta);
+    //clarke and park currents are only computed when they are stored
+    log_clarke = serial_log_output_derived("Clarke Transformation", log_currents, clarke_log_values, NULL, 2, "alpha", "beta");
     if(log_clarke == NULL)
     {
         return 1;
     }
 
-    log_park = serial_log_output("Park Transformation", 300, 2, "direct", &park.direct, "quadrature", &park.quadrature);
-    if(log_park == NULL)
+    if(serial_log_output_derived("Park Transformation", log_clarke, park_log_values, (void *)&rotor_position, 2, "direct", "quadrature") == NULL)
     {
         return 1;
-    }*/
+    }
 
     if(serial_log_input("Frequency", 10, freq_update) == NULL)
     {
@@ -209,8 +247,6 @@ int main(void)
         current.b = current.a;
         current.c = current.a;// + 10.0;
         //current = generate_sinusoidal_currents(amplitude, rotor_position);
-        //clarke = clarke_transformation(&current);
-        //park = park_transformation(&clarke, rotor_position);
 
         if(rotor_position > 360.0)
         {
@@ -0,0 +1,245 @@
+/*
+ * serial_log_decode.c
+ *
+ *      Author: RanaBasheer
+ */
+#include <string.h>
+#include <math.h>
+#include "serial_log_decode.h"
+
+#define EVENT_RECORD_BITS   48 //16 bit tick delta and 32 bit value
+#define V2_MARKER           0x30 //protocol v1 headers never have stream index 3
+#define LINK_COMMAND_INDEX  0xFF
+
+/*
+ * reads bit_count bits starting at bit_offset. The logger packs the bits of
+ * its 32 bit words starting from the least significant one
+ */
+static uint32_t read_data_bits(const uint8_t *data, uint32_t bit_offset, uint32_t bit_count)
+{
+    uint32_t value = 0;
+    uint32_t i;
+    for(i = 0; i < bit_count; ++i)
+    {
+        uint32_t bit = bit_offset + i;
+        value |= (uint32_t)((data[bit >> 3] >> (bit & 0x7)) & 0x1) << i;
+    }
+    return value;
+}
+
+static float bits_to_float(uint32_t value)
+{
+    float data;
+    memcpy(&data, &value, sizeof(data));
+    return data;
+}
+
+int serial_log_decode_events(const uint8_t *data, uint32_t byte_count, float *last_value, float *samples, int max_sample_count)
+{
+    uint32_t bit_offset;
+    uint32_t bit_count = byte_count*8;
+    int count = 0;
+    for(bit_offset = 0; bit_offset + EVENT_RECORD_BITS <= bit_count; bit_offset += EVENT_RECORD_BITS)
+    {
+        uint32_t delta = read_data_bits(data, bit_offset, 16);
+        float value = bits_to_float(read_data_bits(data, bit_offset + 16, 32));
+        //the previous value holds until the tick of this record
+        while(delta > 1 && !isnan(*last_value) && count < max_sample_count)
+        {
+            samples[count++] = *last_value;
+            delta--;
+        }
+        if(count < max_sample_count)
+        {
+            samples[count++] = value;
+        }
+        *last_value = value;
+    }
+    return count;
+}
+
+/*
+ * every value after the first one is xored with the previous value and only the
+ * changed bits are sent, see serial_log_compress.c of the logger
+ */
+int serial_log_decode_compressed(const uint8_t *data, uint32_t byte_count, uint32_t sample_count, float *samples)
+{
+    uint32_t bit_offset = 32;
+    uint32_t bit_count = byte_count*8;
+    uint32_t value, leading_zero_count = 0, meaningful_bit_count = 0;
+    uint32_t count;
+    if(sample_count == 0 || bit_count < 32)
+        return 0;
+    value = read_data_bits(data, 0, 32);
+    samples[0] = bits_to_float(value);
+    for(count = 1; count < sample_count; ++count)
+    {
+        if(bit_offset + 1 > bit_count)
+            break;
+        if(read_data_bits(data, bit_offset++, 1))
+        {
+            if(bit_offset + 1 > bit_count)
+                break;
+            if(read_data_bits(data, bit_offset++, 1))
+            {
+                //a new window of changed bits
+                if(bit_offset + 11 > bit_count)
+                    break;
+                leading_zero_count = read_data_bits(data, bit_offset, 5);
+                meaningful_bit_count = read_data_bits(data, bit_offset + 5, 6);
+                bit_offset += 11;
+            }
+            if(meaningful_bit_count == 0 || leading_zero_count + meaningful_bit_count > 32 ||
+               bit_offset + meaningful_bit_count > bit_count)
+                break;
+            value ^= read_data_bits(data, bit_offset, meaningful_bit_count) << (32 - leading_zero_count - meaningful_bit_count);
+            bit_offset += meaningful_bit_count;
+        }
+        samples[count] = bits_to_float(value);
+    }
+    return count;
+}
+
+static uint32_t read_bytes(const uint8_t *data, int index, int byte_count)
+{
+    uint32_t value = 0;
+    int i;
+    for(i = 0; i < byte_count; ++i)
+    {
+        value |= (uint32_t)data[index + i] << (8*i);
+    }
+    return value;
+}
+
+/*
+ * reads the varint at index and moves index past it. Returns false if data ends first
+ */
+static int read_varint(const uint8_t *data, uint32_t length, int *index, uint32_t *value)
+{
+    int shift = 0;
+    *value = 0;
+    while((uint32_t)*index < length && shift < 32)
+    {
+        uint8_t byte = data[(*index)++];
+        *value |= (uint32_t)(byte & 0x7F) << shift;
+        if((byte & 0x80) == 0)
+            return 1;
+        shift += 7;
+    }
+    return 0;
+}
+
+/*
+ * string payloads are the length followed by the characters
+ */
+static uint32_t get_string_payload_length(const uint8_t *data, uint32_t length, int index)
+{
+    return ((uint32_t)index < length)?(uint32_t)data[index] + 1:1;
+}
+
+static int decode_v1_record(const uint8_t *data, uint32_t length, serial_log_record_t *record)
+{
+    record->version = 1;
+    record->type = (serial_log_record_type_t)(data[0] >> 6);
+    record->stream_index = (data[0] >> 4) & 0x3;
+    record->log_index = data[0] & 0xF;
+    switch(record->type)
+    {
+    case SERIAL_LOG_RECORD_TITLE:
+        record->payload_length = get_string_payload_length(data, length, 1);
+        return 1;
+    case SERIAL_LOG_RECORD_NAME:
+        if(length < 2)
+            return 0;
+        record->type_length_in_bits = data[1];
+        record->payload_length = get_string_payload_length(data, length, 2);
+        return 2;
+    case SERIAL_LOG_RECORD_DATA:
+        if(length < 5)
+            return 0;
+        record->payload_length = read_bytes(data, 1, 2);
+        record->offset = read_bytes(data, 3, 2);
+        return 5;
+    default:
+        if(length < 3)
+            return 0;
+        record->log_index = 0;
+        record->stream_index = 0;
+        record->value = read_bytes(data, 1, 2);
+        return 3;
+    }
+}
+
+static int decode_v2_record(const uint8_t *data, uint32_t length, serial_log_record_t *record)
+{
+    int index = 1;
+    record->version = 2;
+    record->type = (serial_log_record_type_t)(data[0] & 0xF);
+    if(record->type == SERIAL_LOG_RECORD_PROTOCOL)
+    {
+        if(length < 2)
+            return 0;
+        record->version = data[1];
+        return 2;
+    }
+    if(!read_varint(data, length, &index, &record->log_index))
+        return 0;
+    switch(record->type)
+    {
+    case SERIAL_LOG_RECORD_TITLE:
+        record->payload_length = get_string_payload_length(data, length, index);
+        return index;
+    case SERIAL_LOG_RECORD_NAME:
+        if(!read_varint(data, length, &index, &record->stream_index) || (uint32_t)index + 2 > length)
+            return 0;
+        record->type_length_in_bits = data[index];
+        record->mode = data[index + 1];
+        record->payload_length = get_string_payload_length(data, length, index + 2);
+        return index + 2;
+    case SERIAL_LOG_RECORD_DATA:
+    case SERIAL_LOG_RECORD_COMPRESSED_DATA:
+        if(!read_varint(data, length, &index, &record->stream_index) || (uint32_t)index + 20 > length)
+            return 0;
+        record->payload_length = read_bytes(data, index, 4);
+        record->offset = read_bytes(data, index + 4, 4);
+        record->sample_tick = read_bytes(data, index + 8, 4);
+        record->capture_id = read_bytes(data, index + 12, 4);
+        record->trigger_position = read_bytes(data, index + 16, 2);
+        record->history_start = read_bytes(data, index + 18, 2);
+        if(record->type == SERIAL_LOG_RECORD_DATA)
+            return index + 20;
+        if((uint32_t)index + 24 > length)
+            return 0;
+        record->sample_count = read_bytes(data, index + 20, 4);
+        return index + 24;
+    case SERIAL_LOG_RECORD_INPUT:
+        if((uint32_t)index + 2 > length)
+            return 0;
+        record->value = read_bytes(data, index, 2);
+        return index + 2;
+    default:
+        return 0;
+    }
+}
+
+int serial_log_decode_record(const uint8_t *data, uint32_t length, serial_log_record_t *record)
+{
+    memset(record, 0, sizeof(serial_log_record_t));
+    if(length == 0)
+    {
+        return 0;
+    }
+    if((data[0] & 0xF0) == V2_MARKER)
+    {
+        return decode_v2_record(data, length, record);
+    }
+    return decode_v1_record(data, length, record);
+}
+
+int serial_log_encode_protocol_request(uint8_t *data)
+{
+    data[0] = LINK_COMMAND_INDEX;
+    data[1] = 0; //set protocol
+    data[2] = SERIAL_LOG_DECODE_PROTOCOL;
+    return 3;
+}
@@ -0,0 +1,73 @@
+/*
+ * serial_log_decode.h
+ *
+ * Decoders for the data buffers that the logger sends. These are meant to be
+ * built into the host application that receives the serial log.
+ *
+ *      Author: RanaBasheer
+ */
+
+#ifndef SERIAL_LOG_DECODE_H_
+#define SERIAL_LOG_DECODE_H_
+#include <stdint.h>
+
+//protocol version that the host asks for with serial_log_encode_protocol_request
+#define SERIAL_LOG_DECODE_PROTOCOL  2
+
+typedef enum serial_log_record_type_t {
+    SERIAL_LOG_RECORD_TITLE = 0,    //payload is the title of a log
+    SERIAL_LOG_RECORD_NAME,         //payload is the name of a stream
+    SERIAL_LOG_RECORD_DATA,         //payload is a data buffer of a stream
+    SERIAL_LOG_RECORD_INPUT,        //follows the title of an input log
+    SERIAL_LOG_RECORD_PROTOCOL,     //the logger switched to the protocol version
+    SERIAL_LOG_RECORD_COMPRESSED_DATA //payload is a compressed data buffer. Decode it with serial_log_decode_compressed
+} serial_log_record_type_t;
+
+/*
+ * Header of a record of a packet sent by the logger. A packet holds one or more records
+ * and every record is a header followed by payload_length bytes. Titles and names are
+ * sent with their length in the first byte.
+ */
+typedef struct serial_log_record_t {
+    serial_log_record_type_t type;
+    uint8_t version;                //protocol version of the header
+    uint32_t log_index;             //protocol v1 input records belong to the title before them and have 0
+    uint32_t stream_index;
+    uint32_t payload_length;
+    uint32_t offset;                //data records
+    uint32_t sample_tick;           //sampling tick of the first sample of the buffer. Protocol v2 only
+    uint32_t capture_id;            //protocol v2 only, like the trigger position and history start
+    uint16_t trigger_position;
+    uint16_t history_start;
+    uint32_t sample_count;          //compressed data records
+    uint8_t type_length_in_bits;    //name records
+    uint8_t mode;                   //protocol v2 only
+    uint16_t value;                 //input records
+} serial_log_record_t;
+
+/*
+ * Decodes the header of the record at the start of data, which can be in the format of protocol v1
+ * or v2. Returns the length of the header, or 0 if data does not hold the whole header.
+ */
+int serial_log_decode_record(const uint8_t *data, uint32_t length, serial_log_record_t *record);
+/*
+ * Writes the payload of the packet that asks the logger for protocol v2 and returns its length. Loggers
+ * that do not know protocol v2 ignore it and keep sending protocol v1 records.
+ */
+int serial_log_encode_protocol_request(uint8_t *data);
+
+/*
+ * Rebuilds the step signal of an event stream at the sampling rate. last_value holds the value
+ * before the first record and is updated to the last one so that buffers can be decoded in order.
+ * Start with NAN so that the signal begins at the first record of the log.
+ * Returns the number of samples written to samples which is never more than max_sample_count.
+ */
+int serial_log_decode_events(const uint8_t *data, uint32_t byte_count, float *last_value, float *samples, int max_sample_count);
+/*
+ * Rebuilds the samples of a compressed data buffer. sample_count comes from the record header.
+ * Returns the number of samples written to samples, which is less than sample_count if the
+ * buffer ends early.
+ */
+int serial_log_decode_compressed(const uint8_t *data, uint32_t byte_count, uint32_t sample_count, float *samples);
+
+#endif /* SERIAL_LOG_DECODE_H_ */
@@ -9,6 +9,7 @@
 #define SERIAL_LOG_H_
 #include <stdbool.h>
 #include <stdint.h>
+#include <stddef.h>
 typedef enum log_error_code_t {
     STREAM_LOG_ERR_OUT_OF_MEMORY = 1,
     STREAM_LOG_ERR_MAX_LOGS_REACHED,
@@ -16,6 +17,146 @@ typedef enum log_error_code_t {
 } log_error_code_t;
 
 typedef void (*log_input_handler_t)(int);
+//computes the values of a derived log from the filtered values of its source log
+typedef void (*serial_log_derive_t)(const float *source_values, float *values, void *context);
+
+typedef enum log_trigger_mode_t {
+    SERIAL_LOG_TRIGGER_DC = 0,      //source crosses its own slowly filtered dc value
+    SERIAL_LOG_TRIGGER_LEVEL,       //source crosses an absolute level
+    SERIAL_LOG_TRIGGER_FREE_RUN,    //a new capture starts as soon as the last one was sent
+    SERIAL_LOG_TRIGGER_MANUAL       //capture only starts on serial_log_force_trigger
+} log_trigger_mode_t;
+
+typedef enum log_trigger_edge_t {
+    SERIAL_LOG_TRIGGER_RISING = 1,
+    SERIAL_LOG_TRIGGER_FALLING = 2,
+    SERIAL_LOG_TRIGGER_BOTH = 3
+} log_trigger_edge_t;
+
+typedef enum log_stream_mode_t {
+    SERIAL_LOG_STREAM_SAMPLE = 0,   //low pass filtered value at every store tick
+    SERIAL_LOG_STREAM_PEAK,         //min and max of the raw value over every decimation interval
+    SERIAL_LOG_STREAM_STATISTICS,   //mean, rms, min, max and sample count of the raw value over every window
+    SERIAL_LOG_STREAM_SPECTRUM,     //quantized magnitude bins of every capture
+    SERIAL_LOG_STREAM_EVENT         //16 bit tick delta and the raw value whenever the value changes
+} log_stream_mode_t;
+
+typedef enum log_filter_t {
+    SERIAL_LOG_FILTER_SINGLE_POLE = 0,      //first order low pass at the bandwidth of the log
+    SERIAL_LOG_FILTER_BUTTERWORTH,          //second order butterworth low pass at the bandwidth of the log
+    SERIAL_LOG_FILTER_BUTTERWORTH_FIXED,    //same as SERIAL_LOG_FILTER_BUTTERWORTH in 32 bit fixed point. Values are limited to +/-32767
+    SERIAL_LOG_FILTER_BOXCAR                //mean over every decimation interval. Only additions on the ticks in between
+} log_filter_t;
+
+/*
+ * Usage of the memory passed to serial_log_init. All sizes are in sizeof units and include the
+ * block headers of the allocations
+ */
+typedef struct serial_log_memory_stats_t {
+    uint32_t size;
+    uint32_t used;
+    uint32_t high_water_mark;   //largest used since serial_log_init
+    uint32_t largest_free;      //largest allocation that can still be made
+    uint16_t free_blocks;       //more than one free block means the memory is fragmented
+} serial_log_memory_stats_t;
+
+//independent logger with its own logs, memory, sample groups and serial link
+typedef struct serial_log_instance_t serial_log_instance_t;
+
+/*
+ * Serial link of an instance. Every function gets the context so that one set of
+ * functions can serve several ports
+ */
+typedef struct serial_log_link_t {
+    void (*tx)(void *context, unsigned char data);
+    unsigned char (*rx)(void *context);
+    bool (*is_tx_more)(void *context);     //true if it is ok to send more data
+    bool (*is_rx_ready)(void *context);    //true if there is data to be read
+    void *context;
+} serial_log_link_t;
+
+/*
+ * Description of a single stream of an output log
+ */
+typedef struct serial_log_stream_t {
+    const char *name;
+    float *data_ptr;
+    log_stream_mode_t mode;
+    float deadband;     //only used by event logs
+} serial_log_stream_t;
+
+typedef enum log_plan_type_t {
+    SERIAL_LOG_PLAN_CAPTURE = 0,    //serial_log_output, _triggered, _streams and _struct. rate is the bandwidth
+    SERIAL_LOG_PLAN_DERIVED,        //rate is the bandwidth of the source log
+    SERIAL_LOG_PLAN_STATISTICS,     //rate is the window in ticks
+    SERIAL_LOG_PLAN_SPECTRUM,       //rate is the bandwidth
+    SERIAL_LOG_PLAN_EVENTS,         //rate is the heartbeat in ticks
+    SERIAL_LOG_PLAN_BURST           //rate is the burst length
+} log_plan_type_t;
+
+/*
+ * Description of an output log that is going to be created, used to size the memory passed to
+ * serial_log_init. The arguments follow the function that creates the log.
+ */
+typedef struct serial_log_plan_t {
+    log_plan_type_t type;
+    const char *title;                  //NULL plans for a title of MAX_NAME_SIZE-1 characters
+    int stream_count;
+    const serial_log_stream_t *streams; //only the names and modes are used. NULL plans for sample streams with the longest names
+    uint16_t sampling_rate_in_hz;       //rate of the sample group that the log is created in
+    uint16_t rate;
+    uint16_t fft_size;                  //only used by spectrum logs
+    size_t struct_size;                 //only used by struct logs, else 0
+    uint8_t reserved_buffers;           //own buffers of every stream. 0 plans for the default
+    bool compressed;                    //plans the output buffer of serial_log_set_compression for capture logs
+    uint8_t source_stream_count;        //streams of the source log of a derived log. 0 plans for a source from serial_log_output
+} serial_log_plan_t;
+
+/*
+ * Memory that a set of planned logs takes up, in sizeof units
+ */
+typedef struct serial_log_memory_plan_t {
+    uint32_t size;      //smallest memory that fits all the logs
+    uint32_t logs;      //logs and their titles
+    uint32_t streams;   //streams, their names and buffer descriptors
+    uint32_t data;      //sample data buffers
+    uint32_t extra;     //struct snapshots, derived values, spectrum tables and compression buffers
+    uint32_t headers;   //block headers of the allocations
+} serial_log_memory_plan_t;
+
+typedef enum log_field_type_t {
+    SERIAL_LOG_FIELD_FLOAT = 0,
+    SERIAL_LOG_FIELD_INT16,
+    SERIAL_LOG_FIELD_UINT16,
+    SERIAL_LOG_FIELD_INT32,
+    SERIAL_LOG_FIELD_UINT32
+} log_field_type_t;
+
+/*
+ * Description of a single field of a struct that is logged with serial_log_output_struct.
+ * Use SERIAL_LOG_FIELD to fill it in at compile time.
+ */
+typedef struct serial_log_field_t {
+    const char *name;
+    size_t offset;          //offset of the field from the start of the struct
+    log_field_type_t type;
+} serial_log_field_t;
+
+#define SERIAL_LOG_FIELD(struct_type, field, field_type) {#field, offsetof(struct_type, field), field_type}
+
+/*
+ * Trigger configuration of an output log. The trigger is armed once the source stream
+ * moves hysteresis away from the level on the opposite side of the edge and it fires when
+ * the level is crossed with a change of at least slope per sampling tick.
+ */
+typedef struct serial_log_trigger_t {
+    log_trigger_mode_t mode;
+    log_trigger_edge_t edge;
+    uint8_t source_stream;  //index of the stream that the trigger watches
+    float level;            //only used by SERIAL_LOG_TRIGGER_LEVEL
+    float hysteresis;
+    float slope;            //zero accepts any crossing
+} serial_log_trigger_t;
 
 /*
  * This function allows plotting data on workbench. If you have multiple streams
@@ -28,14 +169,211 @@ typedef void (*log_input_handler_t)(int);
  *
  */
 void *serial_log_output(const char * title, uint16_t signal_bandwidth_in_hz, int stream_count,...);
+/*
+ * Keeps the last sample_count decimated samples from before the trigger at the head of
+ * every capture of this output log. The count is limited to what fits in one data buffer.
+ */
+void serial_log_set_pre_trigger(void *log_output_ptr, uint16_t sample_count);
+/*
+ * Same as serial_log_output but every field comes from one struct at struct_ptr. The struct is copied
+ * once per sampling tick so all of its fields are sampled at the same instant. Returns NULL if
+ * a field does not lie completely inside the struct_size bytes of the struct.
+ *
+ * For e.g.
+ * static const serial_log_field_t coil_fields[] = {
+ *     SERIAL_LOG_FIELD(coil_currents_t, a, SERIAL_LOG_FIELD_FLOAT),
+ *     SERIAL_LOG_FIELD(coil_currents_t, b, SERIAL_LOG_FIELD_FLOAT)
+ * };
+ * serial_log_output_struct("Coil Currents", 300, &current, sizeof(current), 2, coil_fields);
+ */
+void *serial_log_output_struct(const char * title, uint16_t signal_bandwidth_in_hz, const volatile void *struct_ptr, size_t struct_size,
+                               int field_count, const serial_log_field_t *fields);
+/*
+ * Creates an output log whose streams are computed by derive_func from the filtered values of the
+ * streams of source_log_ptr, which has to be a log created by serial_log_output and not another
+ * derived log. derive_func is only called once per stored sample of the source bandwidth instead of
+ * on every tick. The stream names follow stream_count and the source log has to stay open as long as
+ * the derived log.
+ *
+ * For e.g. serial_log_output_derived("Clarke Transformation", log_currents, clarke_func, NULL, 2, "alpha", "beta");
+ */
+void *serial_log_output_derived(const char * title, void *source_log_ptr, serial_log_derive_t derive_func, void *context, int stream_count,...);
+/*
+ * Same as serial_log_output but with the trigger configured at creation. By default a log
+ * triggers on the first stream rising through its dc value.
+ */
+void *serial_log_output_triggered(const char * title, uint16_t signal_bandwidth_in_hz, const serial_log_trigger_t *trigger, int stream_count,...);
+/*
+ * Creates an output log from an array of stream descriptions which allows a mode to be
+ * chosen for every stream. trigger can be NULL to use the default trigger.
+ *
+ * Logs created from an array, including event, struct and static logs, can be wide with up to 32 streams.
+ * All the streams of a log share its trigger, its decimation and the capture id of their buffers, so
+ * for e.g. the phase currents, phase voltages, dc bus, angle and speed of a control loop are captured
+ * time aligned by a single log. The logs whose streams are passed as arguments take up to 3 streams.
+ * Hosts that use protocol v1 only get the first 3 streams of a wide log.
+ */
+void *serial_log_output_streams(const char * title, uint16_t signal_bandwidth_in_hz, const serial_log_trigger_t *trigger, int stream_count, const serial_log_stream_t *streams);
+/*
+ * Creates an output log that stores the raw value of its streams on every sampling tick for burst_length
+ * ticks once the trigger fires. There is no filtering or bit packing so a burst costs a word store per
+ * stream per tick. The F2806x cost is estimated from the instructions of the store loop at about 12
+ * cycles per stream and 40 cycles per log, it has not been measured on the target. It is measured by
+ * reading a cpu timer around serial_log_sample_data, test/bench_burst.c does the same split on the host
+ * with make -C test bench. A burst is sent as a whole and each stream holds MAX_STREAM_DATA_BUFFERS bursts of memory so that the next
+ * burst can be captured while the last one is being sent. trigger can be NULL to use the default trigger,
+ * which is evaluated on the raw value of the source stream.
+ */
+void *serial_log_output_burst(const char * title, uint16_t burst_length, const serial_log_trigger_t *trigger, int stream_count,...);
+/*
+ * Creates an output log that does not capture waveforms. Instead every window_ticks sampling ticks
+ * it sends the mean, rms, min, max and sample count of every stream over that window. A window of
+ * 1 tick sends every sample and a window of 0 ticks returns NULL.
+ */
+void *serial_log_output_statistics(const char * title, uint16_t window_ticks, int stream_count,...);
+/*
+ * Creates an output log that sends the magnitude spectrum of its streams instead of their waveform.
+ * fft_size filtered samples are captured (rounded down to a power of two from 8 to 1024) and the
+ * spectrum is computed in serial_log_handler. Every spectrum is sent as the full scale amplitude and
+ * the bin width in Hz as floats followed by 16 bit bins. The log runs free unless a trigger is set.
+ */
+void *serial_log_output_spectrum(const char * title, uint16_t signal_bandwidth_in_hz, uint16_t fft_size, int stream_count,...);
+void serial_log_set_spectrum_bins(void *log_output_ptr, uint16_t bin_count);
+/*
+ * Number of spectra of the log that were skipped because a stream had no free data buffer
+ * when the capture completed. The log waits for its buffers to go out and captures again.
+ */
+uint16_t serial_log_get_dropped_spectra(void *log_output_ptr);
+/*
+ * Creates an output log that only stores a record when a stream moves beyond its deadband from the
+ * last stored value, or at least every heartbeat_ticks sampling ticks. A record holds the number of
+ * ticks since the previous record and the raw value of every stream, so the host rebuilds a step signal.
+ */
+void *serial_log_output_events(const char * title, uint16_t heartbeat_ticks, int stream_count, const serial_log_stream_t *streams);
+/*
+ * Selects the anti-alias filter of a capture or spectrum log. The coefficients are computed from the
+ * bandwidth when the log is created so changing the filter only restarts it from the current value.
+ */
+void serial_log_set_filter(void *log_output_ptr, log_filter_t filter);
+/*
+ * Sends the sample streams of a capture log with an xor encoding of consecutive values so that slowly
+ * changing signals take a few bits per sample instead of 32 and captures reach the host sooner. The
+ * sampling interrupt still stores plain samples and serial_log_handler compresses every filled buffer
+ * before it is sent, keeping it plain if it would not get smaller. Only hosts that switched to protocol
+ * v2 can decode these buffers, so they are sent plain until then. Enabling it the first time takes an
+ * output buffer of one data buffer from the memory of the logs. Logs from serial_log_output_static are
+ * not compressed.
+ */
+void serial_log_set_compression(void *log_output_ptr, bool enabled);
+void serial_log_set_trigger(void *log_output_ptr, const serial_log_trigger_t *trigger);
+void serial_log_force_trigger(void *log_output_ptr);
+/*
+ * Makes the member log start its captures on the same tick as the master log. All the logs of
+ * a group share the capture id reported with their data so the host can overlay them. The capture
+ * id, like the position of the pre-trigger history, is only sent to hosts that use protocol v2.
+ */
+bool serial_log_join_trigger_group(void *master_log_ptr, void *member_log_ptr);
 void *serial_log_input(const char * title, int init_value, log_input_handler_t handler_func);
 
 bool serial_log_data(void *log_input_ptr,...);
 int serial_log_get_input_value(void *log_input_ptr);
 
+/*
+ * Closes an input or output log. Its slot and memory are given back in serial_log_handler once the
+ * log is no longer being sent. Closing the source of derived logs closes the derived logs as well.
+ */
 void serial_log_close(void *log_input_ptr);
+void serial_log_get_memory_stats(serial_log_memory_stats_t *stats);
+/*
+ * Computes the memory that serial_log_init needs for the planned logs without creating them, when the
+ * data buffers of every log hold storage_time_in_ms of samples. Returns the size in sizeof units and
+ * fills in the breakdown when it is not NULL. The size is exact as long as the logs are created in a
+ * fresh memory and the planned titles and names are the ones that are used.
+ *
+ * For e.g.
+ * static const serial_log_plan_t plans[] = {
+ *     {SERIAL_LOG_PLAN_CAPTURE, "Coil Currents", 3, NULL, 10000, 300, 0, 0},
+ *     {SERIAL_LOG_PLAN_STATISTICS, "Bus", 1, NULL, 10000, 1000, 0, 0}
+ * };
+ * serial_log_plan_memory(plans, 2, 1000, NULL);
+ */
+uint32_t serial_log_plan_memory(const serial_log_plan_t *plans, int plan_count, uint16_t storage_time_in_ms, serial_log_memory_plan_t *breakdown);
+/*
+ * Longest storage time in ms for which the planned logs fit in a memory of log_memory_size. Every log then
+ * buffers the same time span so the buffer depth of each log follows its data rate. Returns 0 if they do not fit.
+ */
+uint16_t serial_log_plan_storage_time(const serial_log_plan_t *plans, int plan_count, uint32_t log_memory_size);
+//number of samples that every data buffer of the planned log holds at storage_time_in_ms
+uint32_t serial_log_plan_samples_per_buffer(const serial_log_plan_t *plan, uint16_t storage_time_in_ms);
+//memory that serial_log_init_buffer_pool takes up, in sizeof units
+uint32_t serial_log_plan_buffer_pool(uint16_t buffer_count, uint32_t buffer_size);
+/*
+ * Sets the time span of data that the buffers of the logs that are created next hold. Defaults to
+ * STORAGE_TIME_IN_MS. Burst and spectrum logs always hold a whole burst or spectrum per buffer.
+ */
+void serial_log_set_storage_time(uint16_t storage_time_in_ms);
+/*
+ * Every stream owns a number of data buffers, MAX_STREAM_DATA_BUFFERS(4) by default, so that it can fill one
+ * while the others wait to be sent. A pool of buffer_count buffers of buffer_size sizeof units lets a stream
+ * borrow more buffers once its own are all in use, so a bursty log buffers deeper instead of overflowing while
+ * the buffers of quiet logs sit idle. Only streams whose buffers fit in buffer_size can borrow and a borrowed
+ * buffer goes back to the pool once it is sent. Every sample group has its own pool, which only its streams
+ * borrow from, so that nested sampling interrupts never share one. The pool is set up for the group selected
+ * by serial_log_use_sample_group. Call it once per group after serial_log_init. Returns false if the pool
+ * did not fit in the log memory, in which case the buffers that fit are still used.
+ */
+bool serial_log_init_buffer_pool(uint16_t buffer_count, uint32_t buffer_size);
+/*
+ * Sets the number of own buffers, from 1 to MAX_STREAM_DATA_BUFFERS, of every stream of the logs that are
+ * created next. Those buffers are the minimum that the log always has whatever the other logs borrow.
+ * 0 restores the default.
+ */
+void serial_log_set_reserved_buffers(uint8_t buffer_count);
 void serial_log_handler(uint32_t in_current_ms);
+//has to be called at the sampling rate passed to serial_log_init. Samples the logs of sample group 0
+void serial_log_sample_data();
+/*
+ * Sample groups let logs be sampled from different interrupts at their own rate. Group 0 runs at the
+ * rate passed to serial_log_init. Every other group has to be set up with serial_log_init_sample_group
+ * and its logs are sampled by calling serial_log_sample_group_data from the matching interrupt.
+ * Logs join the group selected by serial_log_use_sample_group when they are created.
+ *
+ * For e.g. with a speed loop at 1kHz
+ * serial_log_init_sample_group(1, 1000);
+ * serial_log_use_sample_group(1);
+ * serial_log_output("Speed", 50, 1, "speed", &speed);
+ * serial_log_use_sample_group(0);
+ * and serial_log_sample_group_data(1) in the speed loop interrupt
+ */
+void serial_log_init_sample_group(uint8_t group, uint16_t sampling_rate_in_hz);
+bool serial_log_use_sample_group(uint8_t group);
+void serial_log_sample_group_data(uint8_t group);
 void serial_log_init(void *log_memory, uint32_t log_memory_size, uint16_t sampling_rate_in_hz);
+/*
+ * All the functions above work on the default instance that serial_log_init sets up. More loggers can run
+ * side by side, for e.g. on two serial links at their own rates. serial_log_init_instance sets up an instance
+ * at the start of log_memory, taking serial_log_plan_instance() of it, and uses the rest for its logs. link
+ * can be NULL to use the uart of the platform. Logs are created in the instance selected by
+ * serial_log_use_instance, which also selects the instance that the sample group, storage time, buffer pool
+ * and memory stats functions apply to. The functions that take a log work on the instance of that log.
+ *
+ * For e.g.
+ * serial_log_instance_t *drive = serial_log_init_instance(drive_memory, sizeof(drive_memory), 20000, &uart_b);
+ * serial_log_use_instance(drive);
+ * serial_log_output("Phase Currents", 2000, 1, "ia", &ia);
+ * serial_log_use_instance(NULL);
+ * and serial_log_instance_sample_data(drive) in the drive interrupt, serial_log_instance_handler(drive, ms)
+ * in the main loop
+ */
+serial_log_instance_t *serial_log_init_instance(void *log_memory, uint32_t log_memory_size, uint16_t sampling_rate_in_hz,
+                                                const serial_log_link_t *link);
+//NULL selects the default instance. serial_log_init selects the default instance as well
+void serial_log_use_instance(serial_log_instance_t *instance);
+void serial_log_instance_handler(serial_log_instance_t *instance, uint32_t in_current_ms);
+void serial_log_instance_sample_data(serial_log_instance_t *instance);
+void serial_log_instance_sample_group_data(serial_log_instance_t *instance, uint8_t group);
+//memory that serial_log_init_instance takes up for the instance itself, in sizeof units
+uint32_t serial_log_plan_instance(void);
 
 
 #endif /* SERIAL_LOG_H_ */
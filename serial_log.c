@@ -9,19 +9,43 @@
 #include <stddef.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <float.h>
+#include <math.h>
 #include <serial_log.h>
 #include "serial_log_types.h"
 #include "serial_log_compress.h"
 #include "serial_log_stream.h"
+#include "serial_log_spectrum.h"
+#include "serial_log_memory.h"
+#include "serial_log_static.h"
 #include <serial_log_interface.h>
 
 
-log_t *logs[MAX_LOGS] = {0};
+/*
+ * everything that a logger keeps between calls. Other than the default instance
+ * they live at the start of the memory passed to serial_log_init_instance
+ */
+struct serial_log_instance_t
+{
+    log_t *logs[MAX_LOGS];
+    bool close_pending; //a closed log still has to give back its slot and memory
+    uint16_t sampling_rates[MAX_SAMPLE_GROUPS]; //rate at which the logs of every sample group are sampled
+    uint32_t sample_ticks[MAX_SAMPLE_GROUPS]; //sampling ticks of every sample group so far. Wraps around
+    uint8_t sample_group; //sample group of the logs that are created next
+    uint16_t storage_time; //time span in ms of the buffers of the logs that are created next
+    uint8_t reserved_buffers; //own buffers of every stream of the logs that are created next
+    log_buffer_pool_t pools[MAX_SAMPLE_GROUPS]; //every sample group lends out its own pool from its own interrupt
+    serial_log_memory_t memory;
+    serial_log_stream_context_t stream;
+    uint8_t compress_buffers[MAX_LOG_STREAM_COUNT]; //buffer of every stream that the main loop is compressing
+};
+
 log_error_code_t error_code;
-static void *memory_buffer;
-uint32_t memory_buffer_size;
-uint32_t memory_buffer_position;
-static uint16_t sampling_rate; //rate at which signal is sampled. Default is 1ms.
+static serial_log_instance_t default_instance;
+//instance that logs are created in and that the settings apply to
+static serial_log_instance_t *selected_instance = &default_instance;
+//trigger on the first stream rising through its dc value
+static const serial_log_trigger_t default_trigger = {SERIAL_LOG_TRIGGER_DC, SERIAL_LOG_TRIGGER_RISING, 0, 0, 0, 0};
 //static uint16_t timer_ticks;
 #define CHAR_STORAGE_FACTOR (SERIAL_LOG_BYTES_TO_BITS(1)>>3)
 
@@ -50,6 +74,20 @@ static int log_str_copy(char *dest, char *src, int length)
     return (i+1);
 }
 
+/*
+ * the title and names of static logs stay plain strings in flash. They are only
+ * packed into this buffer while they are being sent
+ */
+char *serial_log_get_packed_name(log_t *log_ptr, char *name, char *packed_name)
+{
+    if(!log_ptr->static_log)
+    {
+        return name;
+    }
+    log_str_copy(packed_name, name, MAX_NAME_SIZE-1);
+    return packed_name;
+}
+
 /*
  * store value at the specified bit offset and number of bits
  */
@@ -101,7 +139,7 @@ static int find_free_log_space_index()
     int i;
       for(i = 0; i < MAX_LOGS; ++i)
       {
-        log_t *log_ptr = logs[i];
+        log_t *log_ptr = selected_instance->logs[i];
         if(log_ptr == NULL)
         {
           return i;
@@ -112,10 +150,14 @@ static int find_free_log_space_index()
 
 
 /*
- * Frees the dynamic memory allocated for the log stream data
+ * stops the log stream from being sent. Its memory is freed along with the log
  */
 static void free_log_stream(log_stream_t *log_stream_ptr)
 {
+    if(log_stream_ptr == NULL)
+    {
+        return;
+    }
     log_stream_ptr->in_use = false; //unclaim this spot
 }
 
@@ -135,19 +177,208 @@ static uint32_t adjust_memory_length(uint32_t length)
 
 static int *allocate_memory(uint32_t size)
 {
-    int *memory = ((int *)memory_buffer + memory_buffer_position);
-    memory_buffer_position+=size;
-    if(memory_buffer_position >= memory_buffer_size)
+    int *memory = serial_log_memory_allocate(&selected_instance->memory, size);
+    if(memory == NULL)
         return NULL;
-    memset(memory, 0, size);
+    memset(memory, 0, size*sizeof(int));
     return memory;
 }
 
+/*
+ * length of the memory that holds a string of char_count characters in the 8bit packed format
+ */
+static uint32_t get_string_memory_length(uint32_t char_count)
+{
+    uint32_t length = char_count+1; //extra character to store the length of the string
+    return adjust_memory_length((length + CHAR_STORAGE_FACTOR/2)/CHAR_STORAGE_FACTOR);
+}
+
+/*
+ * number of bits that a single sample of a stream takes up in its data buffers
+ */
+static uint8_t get_type_length_in_bits(log_stream_mode_t mode)
+{
+    uint8_t type_length_in_bits = SERIAL_LOG_BYTES_TO_BITS(sizeof(float));
+    if(mode == SERIAL_LOG_STREAM_PEAK)
+    {
+        //min followed by max
+        type_length_in_bits *= 2;
+    }
+    else if(mode == SERIAL_LOG_STREAM_STATISTICS)
+    {
+        //mean, rms, min, max and count
+        type_length_in_bits *= 5;
+    }
+    else if(mode == SERIAL_LOG_STREAM_EVENT)
+    {
+        //16 bit tick delta and the value
+        type_length_in_bits += 16;
+    }
+    return type_length_in_bits;
+}
+
+/*
+ * logs that are not plain captures decide the mode of all of their streams
+ */
+static log_stream_mode_t get_stream_mode(log_output_mode_t mode, log_stream_mode_t stream_mode)
+{
+    if(mode == LOG_OUTPUT_STATISTICS)
+        return SERIAL_LOG_STREAM_STATISTICS;
+    if(mode == LOG_OUTPUT_SPECTRUM)
+        return SERIAL_LOG_STREAM_SPECTRUM;
+    if(mode == LOG_OUTPUT_EVENT)
+        return SERIAL_LOG_STREAM_EVENT;
+    return stream_mode;
+}
+
+/*
+ * number of samples that every data buffer of a log holds. The buffers together hold
+ * storage_time of data unless the mode needs a fixed buffer size
+ */
+static uint32_t get_samples_per_buffer(log_output_mode_t mode, uint16_t sampling_rate, uint16_t store_period,
+                                       uint16_t samples_per_buffer, uint16_t storage_time)
+{
+    uint32_t buffer_size;
+    if(samples_per_buffer != 0)
+    {
+        return samples_per_buffer;
+    }
+    if(store_period == 0)
+    {
+        //a sample on every tick is sized like one on every other tick
+        store_period = 1;
+    }
+    buffer_size = ((uint32_t)sampling_rate*storage_time + (uint32_t)store_period*1000 - 1)/((uint32_t)store_period*1000);
+    //buffer size has to be divided among the MAX_STREAM_DATA_BUFFERS
+    buffer_size = (buffer_size + MAX_STREAM_DATA_BUFFERS - 1)/MAX_STREAM_DATA_BUFFERS;
+    if(mode == LOG_OUTPUT_EVENT && buffer_size < MIN_EVENTS_PER_BUFFER)
+    {
+        //changes come in bursts much faster than the heartbeat
+        buffer_size = MIN_EVENTS_PER_BUFFER;
+    }
+    return buffer_size;
+}
+
+/*
+ * output should be sampled atleast twice the bandwidth
+ */
+static uint16_t get_capture_sample_index(uint16_t sampling_rate, uint16_t bandwidth_in_hz)
+{
+    return (sampling_rate + 2*bandwidth_in_hz - 1)/(2*bandwidth_in_hz);
+}
+
+/*
+ * gives a pool buffer that a stream still holds back to the pool through the sampling side
+ */
+static void give_back_pool_buffer(log_buffer_pool_t *pool_ptr, log_stream_data_t *log_stream_data_ptr)
+{
+    log_stream_data_ptr->state = SERIAL_LOG_DATA_NOT_SET;
+    pool_ptr->returned_buffers[pool_ptr->returned_count%MAX_POOL_BUFFERS] = log_stream_data_ptr;
+    pool_ptr->returned_count++;
+}
+
+/*
+ * gives back the memory of the stream and all of its buffers
+ */
+static void free_log_stream_memory(serial_log_memory_t *arena_ptr, log_stream_t *log_stream_ptr)
+{
+    int j;
+    for(j = 0; j < MAX_STREAM_BUFFER_SLOTS; ++j)
+    {
+        if(log_stream_ptr->buffers[j] == NULL)
+            continue;
+        if(j >= log_stream_ptr->reserved_count)
+        {
+            give_back_pool_buffer(log_stream_ptr->pool, log_stream_ptr->buffers[j]);
+            continue;
+        }
+        serial_log_memory_free(arena_ptr, log_stream_ptr->buffers[j]->data_ptr);
+        serial_log_memory_free(arena_ptr, log_stream_ptr->buffers[j]);
+    }
+    serial_log_memory_free(arena_ptr, log_stream_ptr->spectrum_ptr);
+    serial_log_memory_free(arena_ptr, log_stream_ptr->name);
+    serial_log_memory_free(arena_ptr, log_stream_ptr);
+}
+
+/*
+ * gives back all the memory of the log that was allocated when it was created
+ */
+static void free_log_memory(log_t *log_ptr)
+{
+    int i, j;
+    serial_log_memory_t *arena_ptr = &log_ptr->instance->memory;
+    if(log_ptr->static_log)
+    {
+        //only the buffers borrowed from the pool have to go back
+        for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+        {
+            for(j = STREAMS(log_ptr)[i]->reserved_count; j < MAX_STREAM_BUFFER_SLOTS; ++j)
+            {
+                if(STREAMS(log_ptr)[i]->buffers[j] != NULL)
+                    give_back_pool_buffer(STREAMS(log_ptr)[i]->pool, STREAMS(log_ptr)[i]->buffers[j]);
+            }
+        }
+        //the storage can be registered again
+        log_ptr->instance = NULL;
+        return;
+    }
+    if(log_ptr->closed_direction == LOG_OUTPUT)
+    {
+        log_output_t *output_ptr = &log_ptr->type.output;
+        for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+        {
+            if(output_ptr->streams[i] != NULL)
+                free_log_stream_memory(arena_ptr, output_ptr->streams[i]);
+        }
+        serial_log_memory_free(arena_ptr, output_ptr->streams);
+        serial_log_memory_free(arena_ptr, output_ptr->twiddle_ptr);
+        serial_log_memory_free(arena_ptr, output_ptr->snapshot_ptr);
+        serial_log_memory_free(arena_ptr, output_ptr->derived_values);
+        serial_log_memory_free(arena_ptr, output_ptr->compress_ptr);
+    }
+    serial_log_memory_free(arena_ptr, log_ptr->title);
+    serial_log_memory_free(arena_ptr, log_ptr);
+}
+
+/*
+ * prepares a stream whose own buffers are already in place for sampling
+ */
+static void init_log_stream(log_stream_t *log_stream_ptr, const serial_log_stream_t *stream_ptr, log_stream_mode_t mode)
+{
+    int i;
+    log_stream_ptr->in_use = true; //claim this spot
+    log_stream_ptr->pool = &selected_instance->pools[selected_instance->sample_group];
+    log_stream_ptr->tick_ptr = &selected_instance->sample_ticks[selected_instance->sample_group];
+    //assign the data_ptr and the value;
+    log_stream_ptr->data_ptr = stream_ptr->data_ptr;
+    log_stream_ptr->data_value = *stream_ptr->data_ptr;
+    for(i = 0; i < log_stream_ptr->reserved_count; ++i)
+    {
+        log_stream_ptr->buffers[i]->state = SERIAL_LOG_DATA_NOT_SET; //indicate that this space is available
+        log_stream_ptr->buffers[i]->index = i;
+        log_stream_ptr->free_buffers[i] = i;
+    }
+    log_stream_ptr->active_stream_data_ptr = NULL;
+    log_stream_ptr->free_count = log_stream_ptr->reserved_count;
+
+    //check if this machine is big endian or not
+    {
+        uint32_t test_value = 0x12345678;
+        log_stream_ptr->big_endian = ((*((char *)&test_value))&0xFF) == 0x12;
+    }
+    log_stream_ptr->mode = mode;
+    log_stream_ptr->deadband = stream_ptr->deadband;
+    log_stream_ptr->type_length_in_bits = get_type_length_in_bits(mode);
+    log_stream_ptr->min_value = FLT_MAX;
+    log_stream_ptr->max_value = -FLT_MAX;
+}
+
 /*
  * allocate a new log stream inside the log ptr
  */
-static log_stream_t *allocate_new_log_stream(const char *name, float *data_ptr, int total_stream_count)
+static log_stream_t *allocate_new_log_stream(const serial_log_stream_t *stream_ptr, log_stream_mode_t mode)
 {
+    const char *name = stream_ptr->name;
     int i, length;
     int *memory;
     log_stream_t *log_stream_ptr;
@@ -160,128 +391,166 @@ static log_stream_t *allocate_new_log_stream(const char *name, float *data_ptr,
         return NULL;
     }
     log_stream_ptr = (log_stream_t *)memory;
-    log_stream_ptr->in_use = true; //claim this spot
+    log_stream_ptr->reserved_count = selected_instance->reserved_buffers;
 
-    length = strlen((char *)name)+1;
-    length = adjust_memory_length((length + CHAR_STORAGE_FACTOR/2)/CHAR_STORAGE_FACTOR);
-    memory = allocate_memory(length);
+    memory = allocate_memory(get_string_memory_length(strlen(name)));
     if(memory == NULL)
     {
+        free_log_stream_memory(&selected_instance->memory, log_stream_ptr);
         return NULL;
     }
     //assign memory for storing the stream name
     log_stream_ptr->name = (char *)memory;
-    //assign the data_ptr and the value;
-    log_stream_ptr->data_ptr = data_ptr;
-    log_stream_ptr->data_value = *data_ptr;
     //copy the title of this log into this space
     log_str_copy(log_stream_ptr->name, (char *)name, MAX_NAME_SIZE-1);
 
     //allocate memory for the log_stream_data_t objects
-    for(i = 0; i < MAX_STREAM_DATA_BUFFERS; ++i)
+    for(i = 0; i < log_stream_ptr->reserved_count; ++i)
     {
         //assign memory for this data stream here
         length = adjust_memory_length(sizeof(log_stream_data_t));
         memory = allocate_memory(length);
         if(memory == NULL)
         {
+            free_log_stream_memory(&selected_instance->memory, log_stream_ptr);
             return NULL;
         }
-        log_stream_data_t *log_stream_data_ptr = (log_stream_data_t *)memory;
-
-        log_stream_ptr->buffers[i] = log_stream_data_ptr;
-        log_stream_data_ptr->state = SERIAL_LOG_DATA_NOT_SET; //indicate that this space is available
-
+        log_stream_ptr->buffers[i] = (log_stream_data_t *)memory;
     }
-    log_stream_ptr->active_stream_data_ptr = NULL;
+    init_log_stream(log_stream_ptr, stream_ptr, mode);
+    return log_stream_ptr;
+}
 
+/*
+ * returns the number of buffers of the stream that are neither filled nor in transit
+ */
+static uint16_t get_free_buffer_count(log_stream_t *log_stream_ptr)
+{
+    return log_stream_ptr->free_count + (uint16_t)(log_stream_ptr->returned_count - log_stream_ptr->reclaimed_count);
+}
 
+/*
+ * takes a borrowed buffer out of its slot and puts it back into the pool
+ */
+static void return_pool_buffer(log_stream_t *log_stream_ptr, uint8_t buffer_index)
+{
+    log_buffer_pool_t *pool_ptr = log_stream_ptr->pool;
+    pool_ptr->buffers[pool_ptr->free_count++] = log_stream_ptr->buffers[buffer_index];
+    log_stream_ptr->buffers[buffer_index] = NULL;
+    log_stream_ptr->borrowed_count--;
+}
 
-    //check if this machine is big endian or not
+/*
+ * lends a buffer of the pool to the stream in one of its empty slots
+ */
+static log_stream_data_t *borrow_pool_buffer(log_stream_t *log_stream_ptr)
+{
+    int i;
+    log_stream_data_t *log_stream_data_ptr;
+    log_buffer_pool_t *pool_ptr = log_stream_ptr->pool;
+    while(pool_ptr->reclaimed_count != pool_ptr->returned_count)
     {
-        uint32_t test_value = 0x12345678;
-        log_stream_ptr->big_endian = ((*((char *)&test_value))&0xFF) == 0x12;
+        pool_ptr->buffers[pool_ptr->free_count++] = pool_ptr->returned_buffers[pool_ptr->reclaimed_count%MAX_POOL_BUFFERS];
+        pool_ptr->reclaimed_count++;
     }
-    log_stream_ptr->type_length_in_bits = SERIAL_LOG_BYTES_TO_BITS(sizeof(float));
-
+    if(pool_ptr->free_count == 0 || log_stream_ptr->max_bit_count > pool_ptr->max_bit_count)
+    {
+        return NULL;
+    }
+    for(i = log_stream_ptr->reserved_count; i < MAX_STREAM_BUFFER_SLOTS; ++i)
+    {
+        if(log_stream_ptr->buffers[i] == NULL)
+        {
+            log_stream_data_ptr = pool_ptr->buffers[--pool_ptr->free_count];
+            log_stream_data_ptr->index = i;
+            log_stream_ptr->buffers[i] = log_stream_data_ptr;
+            log_stream_ptr->borrowed_count++;
+            return log_stream_data_ptr;
+        }
+    }
+    return NULL;
+}
 
-    return log_stream_ptr;
+/*
+ * moves the oldest buffer returned by the transmit side back to the free buffers, or to
+ * the pool if it was borrowed. Returns false if there was none
+ */
+static bool reclaim_returned_buffer(log_stream_t *log_stream_ptr)
+{
+    uint8_t buffer_index;
+    if(log_stream_ptr->reclaimed_count == log_stream_ptr->returned_count)
+    {
+        return false;
+    }
+    buffer_index = log_stream_ptr->returned_buffers[log_stream_ptr->reclaimed_count%MAX_STREAM_BUFFER_SLOTS];
+    log_stream_ptr->reclaimed_count++;
+    if(buffer_index < log_stream_ptr->reserved_count)
+        log_stream_ptr->free_buffers[log_stream_ptr->free_count++] = buffer_index;
+    else
+        return_pool_buffer(log_stream_ptr, buffer_index);
+    return true;
 }
 
 /*
- * scans through the log_data_streams under the log_stream to find one that
- * can be used to send the data out
+ * takes a free buffer of the stream that can be filled. The pool is only used once all
+ * the own buffers of the stream are filled or being sent
  */
 static log_stream_data_t *find_free_stream_data_buffer(log_stream_t *log_stream_ptr)
 {
-    int i;
+    log_stream_data_t *log_stream_data_ptr;
     if(log_stream_ptr == NULL)
     {
         return  NULL;
     }
 
-    for(i = 0; i < MAX_STREAM_DATA_BUFFERS; ++i)
+    while(reclaim_returned_buffer(log_stream_ptr))
+        ;
+    if(log_stream_ptr->free_count != 0)
     {
-        log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[i];
-
-        if(log_stream_data_ptr->state == SERIAL_LOG_DATA_NOT_SET)
-            return log_stream_data_ptr;
+        log_stream_data_ptr = log_stream_ptr->buffers[log_stream_ptr->free_buffers[--log_stream_ptr->free_count]];
     }
-    return NULL;
+    else
+    {
+        log_stream_data_ptr = borrow_pool_buffer(log_stream_ptr);
+        if(log_stream_data_ptr == NULL)
+        {
+            return NULL;
+        }
+    }
+    log_stream_data_ptr->sequence = log_stream_ptr->fill_sequence++;
+    return log_stream_data_ptr;
 }
 
-static bool log_data(log_stream_t *log_stream_ptr, uint32_t data_offset)
+/*
+ * gives a buffer that was not sent back to the free buffers of the sampling side
+ */
+static void drop_stream_data_buffer(log_stream_t *log_stream_ptr, log_stream_data_t *log_stream_data_ptr)
+{
+    log_stream_data_ptr->state = SERIAL_LOG_DATA_NOT_SET;
+    if(log_stream_data_ptr->index < log_stream_ptr->reserved_count)
+        log_stream_ptr->free_buffers[log_stream_ptr->free_count++] = log_stream_data_ptr->index;
+    else
+        return_pool_buffer(log_stream_ptr, log_stream_data_ptr->index);
+}
+
+/*
+ * called by the transmit side once a buffer has been sent
+ */
+void serial_log_release_buffer(log_stream_t *log_stream_ptr, uint8_t buffer_index)
+{
+    log_stream_ptr->buffers[buffer_index]->state = SERIAL_LOG_DATA_NOT_SET;
+    log_stream_ptr->returned_buffers[log_stream_ptr->returned_count%MAX_STREAM_BUFFER_SLOTS] = buffer_index;
+    log_stream_ptr->returned_count++;
+}
+
+/*
+ * returns the value as a little endian 32 bit word
+ */
+static uint32_t get_value_bits(log_stream_t *log_stream_ptr, float data)
 {
     uint32_t value;
     uint32_t value_le;
-    /*if(log_stream_ptr->active_stream_data_ptr == NULL)
-    {
-        //we don't have an active data buffer. Try to see if one freed up because the serial
-        //code had sent it out
-        log_stream_ptr->active_stream_data_ptr = find_free_stream_data_buffer(log_stream_ptr);
-        if(log_stream_ptr->active_stream_data_ptr == NULL)
-        {
-            //no free data buffer is yet available
-            error_code = STREAM_LOG_ERR_MAX_STREAMS_REACHED;
-            return false;
-        }
-        init_active_stream_data_buffer(log_stream_ptr);
-    }*/
-    float data = log_stream_ptr->data_value;
-    bool is_active_stream_null = (log_stream_ptr->active_stream_data_ptr == NULL);
-    //if the active stream is null then we set the data_bits to a very large value
-    uint32_t data_bits = is_active_stream_null?((uint32_t)-1):log_stream_ptr->active_stream_data_ptr->data_bits;
-    //if we don't have space to add another 32 more bits of data then this buffer is
-    //ready to go out. assign the active buffer as the next free one
-    if(data_bits >= log_stream_ptr->max_bit_count)
-    {
-        if(!is_active_stream_null)
-            log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_READY;
-        #ifdef COMPRESS_STREAM
-          //let's compress this data stream
-          compress_stream(log_stream_ptr);
-        #endif
-        //set_active_stream_data_inactive(log_stream_ptr);
-        log_stream_ptr->active_stream_data_ptr = find_free_stream_data_buffer(log_stream_ptr);
-        if(log_stream_ptr->active_stream_data_ptr == NULL)
-        {
-            #ifdef SERIAL_LOG_DEBUG_PRINTF
-              printf("out of space\n");
-            #endif
-            //error_flag = true;
-            //strcpy(error_str, "out of space");
-            //we have no active space available. so return false
-            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
-            return false;
-        }
-        
-        //we have a new active stream data ptr so reset all the last data metric
-        log_stream_ptr->active_stream_data_ptr->data_bits = 0;
-        log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_FILLING;
-        log_stream_ptr->active_stream_data_ptr->data_offset = data_offset;
-    }
-    
-    value_le = *((uint32_t *)&data);
+    memcpy(&value_le, &data, sizeof(value_le));
     if(log_stream_ptr->big_endian)
     {
         //this is a big endian processor. so we need to swap the bytes to little endian format
@@ -292,370 +561,2303 @@ static bool log_data(log_stream_t *log_stream_ptr, uint32_t data_offset)
     }
     else
         value = value_le;
-
-    store_data_bits(value, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, log_stream_ptr->type_length_in_bits);
-    log_stream_ptr->active_stream_data_ptr->data_bits+=log_stream_ptr->type_length_in_bits;
-    return true;
+    return value;
 }
 
-static log_t *allocate_log_ptr(char *title)
+/*
+ * stores one sample of the stream at the bit offset. Peak streams store the
+ * min and max of the interval and start tracking a new interval
+ */
+static void store_stream_sample(log_stream_t *log_stream_ptr, uint32_t *data_ptr, uint32_t bit_offset)
 {
-    int *memory;
-    int length;
-    log_t *log_ptr;
-    int i = find_free_log_space_index(); //find an index in logs where we will store this log info
-    if(i == INVALID_LOG_INDEX)
+    #define VALUE_BIT_COUNT 32
+    if(log_stream_ptr->mode == SERIAL_LOG_STREAM_PEAK)
     {
-        //invalid pointer passed in
-        error_code = STREAM_LOG_ERR_MAX_LOGS_REACHED;
-        return NULL;
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->min_value), data_ptr, bit_offset, VALUE_BIT_COUNT);
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->max_value), data_ptr, bit_offset + VALUE_BIT_COUNT, VALUE_BIT_COUNT);
+        log_stream_ptr->min_value = FLT_MAX;
+        log_stream_ptr->max_value = -FLT_MAX;
     }
-    length = adjust_memory_length(sizeof(log_t));
-    memory = allocate_memory(length);
-    if(memory == NULL)
+    else if(log_stream_ptr->mode == SERIAL_LOG_STREAM_STATISTICS)
     {
-        return NULL;
+        float count = log_stream_ptr->window_count;
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->sum/count), data_ptr, bit_offset, VALUE_BIT_COUNT);
+        store_data_bits(get_value_bits(log_stream_ptr, sqrtf(log_stream_ptr->sum_of_squares/count)), data_ptr, bit_offset + VALUE_BIT_COUNT, VALUE_BIT_COUNT);
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->min_value), data_ptr, bit_offset + 2*VALUE_BIT_COUNT, VALUE_BIT_COUNT);
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->max_value), data_ptr, bit_offset + 3*VALUE_BIT_COUNT, VALUE_BIT_COUNT);
+        store_data_bits(log_stream_ptr->window_count, data_ptr, bit_offset + 4*VALUE_BIT_COUNT, VALUE_BIT_COUNT);
+        log_stream_ptr->sum = 0;
+        log_stream_ptr->sum_of_squares = 0;
+        log_stream_ptr->window_count = 0;
+        log_stream_ptr->min_value = FLT_MAX;
+        log_stream_ptr->max_value = -FLT_MAX;
     }
-    logs[i] = log_ptr = (log_t *)memory;
-    log_ptr->direction = LOG_OUTPUT;
-
-    length = strlen((char *)title)+1; //extra character to store the length of the string
-    length = adjust_memory_length((length + CHAR_STORAGE_FACTOR/2)/CHAR_STORAGE_FACTOR);
-    memory = allocate_memory(length);
-    if(memory == NULL)
+    else if(log_stream_ptr->mode == SERIAL_LOG_STREAM_EVENT)
     {
-        return NULL;
+        //ticks since the previous record followed by the raw value
+        store_data_bits(log_stream_ptr->event_delta, data_ptr, bit_offset, 16);
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->data_value), data_ptr, bit_offset + 16, VALUE_BIT_COUNT);
+    }
+    else
+    {
+        store_data_bits(get_value_bits(log_stream_ptr, log_stream_ptr->data_value), data_ptr, bit_offset, VALUE_BIT_COUNT);
     }
-    log_ptr->title = (char *)memory;
-    //copy the title of this log into this space
-    log_str_copy(log_ptr->title, (char *)title, MAX_NAME_SIZE-1);
-    return log_ptr;
 }
 
 /*
- * Closes the serial log
+ * claims a free data buffer as the active one and prepares it for filling
  */
-void serial_log_close(void *log_input_ptr)
+static bool init_active_stream_data_buffer(log_stream_t *log_stream_ptr, uint32_t data_offset)
 {
-    int i;
-    log_t *log_ptr = (log_t *)log_input_ptr;
-    if(log_ptr == NULL)
-    {
-        return;
-    }
-    for(i = 0; i < MAX_LOG_STREAM_COUNT; ++i)
+    log_stream_ptr->active_stream_data_ptr = find_free_stream_data_buffer(log_stream_ptr);
+    if(log_stream_ptr->active_stream_data_ptr == NULL)
     {
-      free_log_stream(STREAMS(log_ptr)[i]); //log_ptr->type.output.streams[i]);
+        return false;
     }
-    log_ptr->direction = LOG_UNUSED;
+    log_stream_ptr->active_stream_data_ptr->data_bits = 0;
+    log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_FILLING;
+    log_stream_ptr->active_stream_data_ptr->data_offset = data_offset;
+    log_stream_ptr->active_stream_data_ptr->trigger_position = 0;
+    log_stream_ptr->active_stream_data_ptr->history_start = 0;
+    log_stream_ptr->active_stream_data_ptr->capture_id = log_stream_ptr->capture_id;
+    log_stream_ptr->active_stream_data_ptr->sample_tick = *log_stream_ptr->tick_ptr;
+    log_stream_ptr->active_stream_data_ptr->compressed = false;
+    return true;
 }
 
 /*
- * returns false if all the data buffers for every stream is not transmitting.
- * else it return true indicating a data buffer is in transit for this output log
+ * makes sure that the active buffer of the stream has space for one more sample.
+ * A full buffer is marked ready and a free one is claimed from data_offset
  */
-static bool wait_output_data_buffers_empty(log_t *log_ptr)
+static bool reserve_log_data(log_stream_t *log_stream_ptr, uint32_t data_offset)
 {
-    int i,j;
-    bool in_transit = false;
-    for(j = 0; j < MAX_LOG_STREAM_COUNT; ++j)
+    bool is_active_stream_null = (log_stream_ptr->active_stream_data_ptr == NULL);
+    //if the active stream is null then we set the data_bits to a very large value
+    uint32_t data_bits = is_active_stream_null?((uint32_t)-1):log_stream_ptr->active_stream_data_ptr->data_bits;
+    //if we don't have space to add another 32 more bits of data then this buffer is
+    //ready to go out. assign the active buffer as the next free one
+    if(data_bits >= log_stream_ptr->max_bit_count)
     {
-        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
-        if(log_stream_ptr == NULL)
-            continue;
-        if(log_stream_ptr->active_stream_data_ptr != NULL)
+        if(!is_active_stream_null)
+            log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_READY;
+        //set_active_stream_data_inactive(log_stream_ptr);
+        if(!init_active_stream_data_buffer(log_stream_ptr, data_offset))
         {
-            //if the active stream is still being filled. then stop it
-            if(log_stream_ptr->active_stream_data_ptr->state == SERIAL_LOG_DATA_FILLING)
+            #ifdef SERIAL_LOG_DEBUG_PRINTF
+              printf("out of space\n");
+            #endif
+            //error_flag = true;
+            //strcpy(error_str, "out of space");
+            //we have no active space available. so return false
+            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool log_data(log_stream_t *log_stream_ptr, uint32_t data_offset)
+{
+    if(!reserve_log_data(log_stream_ptr, data_offset))
+    {
+        return false;
+    }
+    store_stream_sample(log_stream_ptr, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits);
+    log_stream_ptr->active_stream_data_ptr->data_bits+=log_stream_ptr->type_length_in_bits;
+    return true;
+}
+
+/*
+ * stores the data at the given position of the circular history kept at the head
+ * of the active buffer while the log is waiting for a trigger
+ */
+static bool log_history_data(log_stream_t *log_stream_ptr, uint16_t position)
+{
+    if(log_stream_ptr->active_stream_data_ptr == NULL)
+    {
+        //history always starts at the beginning of the capture
+        if(!init_active_stream_data_buffer(log_stream_ptr, 0))
+        {
+            return false;
+        }
+    }
+    store_stream_sample(log_stream_ptr, log_stream_ptr->active_stream_data_ptr->data_ptr, (uint32_t)position*log_stream_ptr->type_length_in_bits);
+    return true;
+}
+
+/*
+ * starts storing the log from this tick. If the log keeps a history then the circular
+ * history becomes the head of the capture. The samples are left where they are and
+ * the position of the oldest one is reported to the host
+ */
+static void start_capture(log_t *log_ptr, uint32_t capture_id)
+{
+    int i;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    output_ptr->trigger_state = TRIGGER_ACTIVE;
+    output_ptr->capture_id = capture_id;
+    output_ptr->capture_tick = log_ptr->instance->sample_ticks[output_ptr->sample_group];
+    //the sample at the trigger is always stored
+    output_ptr->sample_count = output_ptr->sample_index;
+    //derived values are computed again on the following store ticks
+    output_ptr->derive_count = 0;
+    output_ptr->store_count = output_ptr->pre_trigger_count;
+    for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[i];
+        if(log_stream_ptr == NULL)
+            continue;
+        log_stream_ptr->capture_id = capture_id;
+        if(output_ptr->filter == SERIAL_LOG_FILTER_BOXCAR)
+        {
+            //the intervals of the capture end on its store ticks
+            log_stream_ptr->sum = 0;
+            log_stream_ptr->window_count = 0;
+        }
+        if(output_ptr->pre_trigger_count == 0 || log_stream_ptr->active_stream_data_ptr == NULL)
+            continue;
+        log_stream_ptr->active_stream_data_ptr->data_bits = (uint32_t)output_ptr->pre_trigger_count*log_stream_ptr->type_length_in_bits;
+        log_stream_ptr->active_stream_data_ptr->trigger_position = output_ptr->pre_trigger_count;
+        log_stream_ptr->active_stream_data_ptr->history_start = output_ptr->history_index;
+        log_stream_ptr->active_stream_data_ptr->capture_id = capture_id;
+        //the oldest sample of the history was taken pre_trigger_count store ticks before the trigger
+        log_stream_ptr->active_stream_data_ptr->sample_tick = output_ptr->capture_tick - (uint32_t)output_ptr->pre_trigger_count*(output_ptr->sample_index + 1);
+    }
+}
+
+/*
+ * restarts filling of the circular history
+ */
+static void reset_history(log_t *log_ptr)
+{
+    log_ptr->type.output.history_index = 0;
+    log_ptr->type.output.history_full = false;
+}
+
+/*
+ * gives back the memory of a log that never made it into logs[]. The sampling side
+ * and the stream layer have not seen it so it does not wait for a close
+ */
+static void discard_log(log_t *log_ptr)
+{
+    log_ptr->closed_direction = log_ptr->direction;
+    free_log_memory(log_ptr);
+}
+
+/*
+ * puts a log that is completely set up in logs[]. From here on the sampling side and
+ * the stream layer use it. A log that fails to get a slot is discarded
+ */
+static log_t *publish_log(log_t *log_ptr)
+{
+    int i;
+    if(log_ptr == NULL)
+    {
+        return NULL;
+    }
+    i = find_free_log_space_index();
+    if(i == INVALID_LOG_INDEX)
+    {
+        error_code = STREAM_LOG_ERR_MAX_LOGS_REACHED;
+        discard_log(log_ptr);
+        return NULL;
+    }
+    selected_instance->logs[i] = log_ptr;
+    return log_ptr;
+}
+
+/*
+ * allocates a log and its title. The log only goes into logs[] through publish_log
+ * once its creator has set it up
+ */
+static log_t *allocate_log_ptr(char *title)
+{
+    int *memory;
+    int length;
+    log_t *log_ptr;
+    if(find_free_log_space_index() == INVALID_LOG_INDEX)
+    {
+        error_code = STREAM_LOG_ERR_MAX_LOGS_REACHED;
+        return NULL;
+    }
+    length = adjust_memory_length(sizeof(log_t));
+    memory = allocate_memory(length);
+    if(memory == NULL)
+    {
+        return NULL;
+    }
+    log_ptr = (log_t *)memory;
+    log_ptr->direction = LOG_OUTPUT;
+    log_ptr->instance = selected_instance;
+
+    memory = allocate_memory(get_string_memory_length(strlen(title)));
+    if(memory == NULL)
+    {
+        discard_log(log_ptr);
+        return NULL;
+    }
+    log_ptr->title = (char *)memory;
+    //copy the title of this log into this space
+    log_str_copy(log_ptr->title, (char *)title, MAX_NAME_SIZE-1);
+    return log_ptr;
+}
+
+/*
+ * removes the log from its trigger group. If it is the master then
+ * all the members go back to using their own trigger
+ */
+static void leave_trigger_group(log_t *log_ptr)
+{
+    log_t *member_ptr = log_ptr->type.output.group_master;
+    if(member_ptr == NULL)
+    {
+        //this is the master so release all the members
+        member_ptr = log_ptr->type.output.group_next;
+        while(member_ptr != NULL)
+        {
+            log_t *next_ptr = member_ptr->type.output.group_next;
+            member_ptr->type.output.group_master = NULL;
+            member_ptr->type.output.group_next = NULL;
+            member_ptr = next_ptr;
+        }
+    }
+    else
+    {
+        //unlink this member from the list that starts at the master
+        while(member_ptr->type.output.group_next != log_ptr)
+        {
+            member_ptr = member_ptr->type.output.group_next;
+        }
+        member_ptr->type.output.group_next = log_ptr->type.output.group_next;
+    }
+    log_ptr->type.output.group_master = NULL;
+    log_ptr->type.output.group_next = NULL;
+}
+
+/*
+ * Closes the serial log
+ */
+void serial_log_close(void *log_input_ptr)
+{
+    int i;
+    log_t *log_ptr = (log_t *)log_input_ptr;
+    log_t **logs;
+    if(log_ptr == NULL)
+    {
+        return;
+    }
+    if(log_ptr->direction == LOG_UNUSED)
+    {
+        return;
+    }
+    logs = log_ptr->instance->logs;
+    if(log_ptr->direction == LOG_OUTPUT)
+    {
+        leave_trigger_group(log_ptr);
+        for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+        {
+          free_log_stream(STREAMS(log_ptr)[i]); //log_ptr->type.output.streams[i]);
+        }
+    }
+    //neither the sampling nor the stream layer use the log from here on
+    log_ptr->closed_direction = log_ptr->direction;
+    log_ptr->direction = LOG_UNUSED;
+    log_ptr->instance->close_pending = true;
+    //derived logs cannot outlive their source
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        if(logs[i] != NULL && logs[i]->direction == LOG_OUTPUT && logs[i]->type.output.source_log == log_ptr)
+        {
+            serial_log_close(logs[i]);
+        }
+    }
+}
+
+/*
+ * gives back the slots and memory of the closed logs. The stream layer may still be
+ * sending a closed log so this waits until it is idle
+ */
+static void release_closed_logs(serial_log_instance_t *instance)
+{
+    int i;
+    if(!instance->close_pending || !is_serial_log_stream_idle(&instance->stream))
+    {
+        return;
+    }
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL || log_ptr->direction != LOG_UNUSED)
+            continue;
+        instance->logs[i] = NULL;
+        free_log_memory(log_ptr);
+    }
+    instance->close_pending = false;
+}
+
+/*
+ * returns false if all the data buffers for every stream is not transmitting.
+ * else it return true indicating a data buffer is in transit for this output log
+ */
+static bool wait_output_data_buffers_empty(log_t *log_ptr)
+{
+    int j;
+    bool in_transit = false;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
+        if(log_stream_ptr == NULL)
+            continue;
+        if(log_stream_ptr->active_stream_data_ptr != NULL)
+        {
+            //if the active stream is still being filled. then stop it
+            if(log_stream_ptr->active_stream_data_ptr->state == SERIAL_LOG_DATA_FILLING)
             {
                 log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_READY;
                 log_stream_ptr->active_stream_data_ptr = NULL;
             }
         }
-        for(i = 0; i < MAX_STREAM_DATA_BUFFERS; ++i)
+        //one returned buffer per tick is reclaimed while waiting so that neither this tick
+        //nor the start of the next capture has to reclaim all of them at once
+        reclaim_returned_buffer(log_stream_ptr);
+        if(get_free_buffer_count(log_stream_ptr) < log_stream_ptr->reserved_count + log_stream_ptr->borrowed_count)
+        {
+            in_transit = true;
+        }
+    }
+    return in_transit;
+}
+
+
+/*
+ * drops the filled buffers of every stream that have not been picked up by the transmit side.
+ * This is only done once when a capture overflows
+ */
+static void drop_output_data_buffers(log_t *log_ptr)
+{
+    int i,j;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
+        if(log_stream_ptr == NULL)
+            continue;
+        log_stream_ptr->active_stream_data_ptr = NULL;
+        for(i = 0; i < MAX_STREAM_BUFFER_SLOTS; ++i)
+        {
+            log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[i];
+            if(log_stream_data_ptr == NULL)
+                continue;
+            //ready buffers belong to the main loop which may be claiming them right now.
+            //only the buffers that are still being filled can be dropped here
+            if(log_stream_data_ptr->state == SERIAL_LOG_DATA_FILLING)
+            {
+                drop_stream_data_buffer(log_stream_ptr, log_stream_data_ptr);
+            }
+        }
+    }
+    //the main loop releases the ready buffers of this capture instead of sending them
+    log_ptr->type.output.dropped_capture_id = log_ptr->type.output.capture_id;
+}
+
+/*
+ * copies the trigger configuration into the log. The hysteresis and slope are stored
+ * as magnitudes so that the ISR only has to apply the sign of the armed edge
+ */
+static void configure_trigger(log_t *log_ptr, const serial_log_trigger_t *trigger)
+{
+    log_trigger_t *trigger_ptr = &log_ptr->type.output.trigger;
+    trigger_ptr->mode = trigger->mode;
+    trigger_ptr->edge = (trigger->edge & SERIAL_LOG_TRIGGER_BOTH)?(trigger->edge & SERIAL_LOG_TRIGGER_BOTH):SERIAL_LOG_TRIGGER_RISING;
+    trigger_ptr->source_stream = (trigger->source_stream < STREAM_COUNT(log_ptr))?trigger->source_stream:0;
+    trigger_ptr->level = trigger->level;
+    trigger_ptr->hysteresis = (trigger->hysteresis < 0)?-trigger->hysteresis:trigger->hysteresis;
+    trigger_ptr->slope = (trigger->slope < 0)?-trigger->slope:trigger->slope;
+    trigger_ptr->sign = 1;
+}
+
+/*
+ * applies the trigger staged by serial_log_set_trigger. The main loop never writes the
+ * trigger the sampling side is running, so a new trigger only takes effect here
+ */
+static void apply_pending_trigger(log_t *log_ptr)
+{
+    log_output_t *output_ptr = &log_ptr->type.output;
+    uint16_t set_count = output_ptr->trigger_set_count;
+    //an odd count means the main loop was interrupted while writing the pending trigger
+    if(set_count == output_ptr->trigger_applied_count || (set_count & 1))
+    {
+        return;
+    }
+    configure_trigger(log_ptr, &output_ptr->pending_trigger);
+    output_ptr->trigger_applied_count = set_count;
+    //the armed edge may have changed, so the log has to arm again
+    if(output_ptr->trigger_state == TRIGGER_ARMED)
+    {
+        output_ptr->trigger_state = TRIGGER_WAIT_FOR_ARM;
+    }
+}
+
+/*
+ * returns true if the log can start a new capture on this tick
+ */
+static bool is_log_ready_for_capture(log_t *log_ptr)
+{
+    log_output_t *output_ptr = &log_ptr->type.output;
+    return (output_ptr->trigger_state == TRIGGER_WAIT_FOR_ARM || output_ptr->trigger_state == TRIGGER_ARMED) &&
+           (output_ptr->pre_trigger_count == 0 || output_ptr->history_full) &&
+           (output_ptr->mode != LOG_OUTPUT_BURST || output_ptr->burst_ready);
+}
+
+/*
+ * a trigger group only fires once every member is able to capture so that
+ * all of them start on the same tick
+ */
+static bool is_trigger_group_ready(log_t *log_ptr)
+{
+    log_t *member_ptr;
+    for(member_ptr = log_ptr->type.output.group_next; member_ptr != NULL; member_ptr = member_ptr->type.output.group_next)
+    {
+        if(!is_log_ready_for_capture(member_ptr))
+            return false;
+    }
+    return true;
+}
+
+/*
+ * runs the trigger state machine of the log for this tick
+ */
+static void update_trigger_state(log_t *log_ptr)
+{
+    log_output_t *output_ptr = &log_ptr->type.output;
+    log_trigger_t *trigger_ptr = &output_ptr->trigger;
+    log_stream_t *source_ptr;
+    log_trigger_state_t log_state;
+    float value, offset, slope;
+
+    apply_pending_trigger(log_ptr);
+    log_state = output_ptr->trigger_state;
+    if(log_state == TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY)
+    {
+        //we are waiting for all the buffers to be empty by sending them out to the host
+        log_state = wait_output_data_buffers_empty(log_ptr)?TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY:TRIGGER_WAIT_FOR_ARM;
+        if(log_state == TRIGGER_WAIT_FOR_ARM)
+            reset_history(log_ptr);
+    }
+    if(log_state == TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW)
+    {
+        //the capture overflowed. We wait for the main loop to release its ready buffers
+        //and for the buffers that were being sent out
+        log_state = wait_output_data_buffers_empty(log_ptr)?TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW:TRIGGER_WAIT_FOR_ARM;
+        if(log_state == TRIGGER_WAIT_FOR_ARM)
+            reset_history(log_ptr);
+    }
+    output_ptr->trigger_state = log_state;
+
+    //members of a trigger group are started by their master
+    if(trigger_ptr->source_stream >= STREAM_COUNT(log_ptr) || output_ptr->group_master != NULL)
+    {
+        return;
+    }
+    source_ptr = STREAMS(log_ptr)[trigger_ptr->source_stream];
+
+    value = source_ptr->data_value;
+    offset = value - ((trigger_ptr->mode == SERIAL_LOG_TRIGGER_DC)?source_ptr->dc_value:trigger_ptr->level);
+    slope = value - trigger_ptr->last_value;
+    trigger_ptr->last_value = value;
+
+    if(log_state == TRIGGER_WAIT_FOR_ARM)
+    {
+        //a forced trigger does not wait for the source, which may never move away from the level
+        if(trigger_ptr->mode == SERIAL_LOG_TRIGGER_FREE_RUN || trigger_ptr->mode == SERIAL_LOG_TRIGGER_MANUAL || trigger_ptr->force)
+        {
+            log_state = TRIGGER_ARMED;
+        }
+        else if((trigger_ptr->edge & SERIAL_LOG_TRIGGER_RISING) && offset <= -trigger_ptr->hysteresis)
+        {
+            //we want the value to dip below the level before it can rise through it
+            trigger_ptr->sign = 1;
+            log_state = TRIGGER_ARMED;
+        }
+        else if((trigger_ptr->edge & SERIAL_LOG_TRIGGER_FALLING) && offset >= trigger_ptr->hysteresis)
+        {
+            trigger_ptr->sign = -1;
+            log_state = TRIGGER_ARMED;
+        }
+        output_ptr->trigger_state = log_state;
+    }
+
+    //a trigger is only accepted once the history has been filled
+    if(is_log_ready_for_capture(log_ptr) && log_state == TRIGGER_ARMED)
+    {
+        bool fire = trigger_ptr->force || (trigger_ptr->mode == SERIAL_LOG_TRIGGER_FREE_RUN);
+        if(trigger_ptr->mode == SERIAL_LOG_TRIGGER_DC || trigger_ptr->mode == SERIAL_LOG_TRIGGER_LEVEL)
+        {
+            //the level has to be crossed along the armed edge fast enough
+            fire |= (trigger_ptr->sign*offset > 0) && (trigger_ptr->sign*slope >= trigger_ptr->slope);
+        }
+        if(fire && is_trigger_group_ready(log_ptr))
+        {
+            log_t *member_ptr;
+            uint32_t capture_id = output_ptr->capture_id + 1;
+            if(capture_id == 0)
+                capture_id = 1; //0 marks the logs that never dropped a capture
+            trigger_ptr->force = false;
+            start_capture(log_ptr, capture_id);
+            for(member_ptr = output_ptr->group_next; member_ptr != NULL; member_ptr = member_ptr->type.output.group_next)
+            {
+                start_capture(member_ptr, capture_id);
+            }
+        }
+    }
+}
+
+/*
+ * converts a stream value to the fixed point format of the fixed point biquad
+ */
+static int32_t get_fixed_value(float value)
+{
+    const float limit = (float)(0x7FFFFFFFL >> STREAM_FIXED_SHIFT);
+    if(value > limit)
+        value = limit;
+    else if(value < -limit)
+        value = -limit;
+    return (int32_t)(value*(float)(1UL << STREAM_FIXED_SHIFT));
+}
+
+/*
+ * runs the second order butterworth filter of the log on a single value of the stream
+ */
+static float filter_biquad(log_output_t *output_ptr, log_stream_t *log_stream_ptr, float value)
+{
+    float *biquad = output_ptr->biquad;
+    float *z = log_stream_ptr->filter_state.z;
+    float filtered = biquad[0]*value + z[0];
+    z[0] = biquad[1]*value - biquad[3]*filtered + z[1];
+    z[1] = biquad[2]*value - biquad[4]*filtered;
+    return filtered;
+}
+
+/*
+ * fixed point version of filter_biquad in direct form I. The products are accumulated
+ * in 64 bits so only the final result is rounded
+ */
+static float filter_biquad_fixed(log_output_t *output_ptr, log_stream_t *log_stream_ptr, float value)
+{
+    int32_t *biquad = output_ptr->biquad_fixed;
+    int32_t *q = log_stream_ptr->filter_state.q;
+    int32_t x = get_fixed_value(value);
+    int64_t accumulator = (int64_t)1 << (BIQUAD_FIXED_SHIFT - 1);
+    accumulator += (int64_t)biquad[0]*x + (int64_t)biquad[1]*q[0] + (int64_t)biquad[2]*q[1];
+    accumulator -= (int64_t)biquad[3]*q[2] + (int64_t)biquad[4]*q[3];
+    q[1] = q[0];
+    q[0] = x;
+    q[3] = q[2];
+    q[2] = (int32_t)(accumulator >> BIQUAD_FIXED_SHIFT);
+    return (float)q[2]*(1.0f/(float)(1UL << STREAM_FIXED_SHIFT));
+}
+
+/*
+ * adds the value to the decimation interval of the stream. The filtered value and the
+ * dc value are only updated once the interval is complete
+ */
+static void filter_boxcar(log_output_t *output_ptr, log_stream_t *log_stream_ptr, float value, float dc_lpf)
+{
+    float count, mean;
+    log_stream_ptr->sum += value;
+    if(++log_stream_ptr->window_count <= output_ptr->sample_index)
+        return;
+    count = log_stream_ptr->window_count;
+    mean = log_stream_ptr->sum/count;
+    log_stream_ptr->data_value = mean;
+    log_stream_ptr->dc_value += dc_lpf*count*(mean - log_stream_ptr->dc_value);
+    log_stream_ptr->sum = 0;
+    log_stream_ptr->window_count = 0;
+}
+
+/*
+ * copies the struct of the log in one go and converts the fields that are not
+ * floats so that all the streams of the log see the values of the same instant
+ */
+static void take_struct_snapshot(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    char *snapshot_ptr = (char *)output_ptr->snapshot_ptr;
+    memcpy(snapshot_ptr, (const void *)output_ptr->struct_ptr, output_ptr->struct_size);
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        switch(log_stream_ptr->field_type)
+        {
+        case SERIAL_LOG_FIELD_INT16:
+            *log_stream_ptr->data_ptr = *(int16_t *)(snapshot_ptr + log_stream_ptr->field_offset);
+            break;
+
+        case SERIAL_LOG_FIELD_UINT16:
+            *log_stream_ptr->data_ptr = *(uint16_t *)(snapshot_ptr + log_stream_ptr->field_offset);
+            break;
+
+        case SERIAL_LOG_FIELD_INT32:
+            *log_stream_ptr->data_ptr = *(int32_t *)(snapshot_ptr + log_stream_ptr->field_offset);
+            break;
+
+        case SERIAL_LOG_FIELD_UINT32:
+            *log_stream_ptr->data_ptr = *(uint32_t *)(snapshot_ptr + log_stream_ptr->field_offset);
+            break;
+
+        default:
+            //float streams point straight into the snapshot
+            break;
+        }
+    }
+}
+
+/*
+ * computes the streams of a derived log once every decimation interval. It runs after all
+ * the other logs of the tick, so the source log is already filtered whatever its slot
+ */
+static void derive_output_data(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    log_t *source_ptr = output_ptr->source_log;
+    float *source_values = output_ptr->source_values;
+    float dc_lpf;
+
+    if(++output_ptr->derive_count <= output_ptr->sample_index)
+        return;
+    output_ptr->derive_count = 0;
+    for(j = 0; j < STREAM_COUNT(source_ptr); ++j)
+    {
+        source_values[j] = STREAMS(source_ptr)[j]->data_value;
+    }
+    output_ptr->derive_func(source_values, output_ptr->derived_values, output_ptr->derive_context);
+
+    //the inputs are already filtered so only the dc value is followed at the decimated rate
+    dc_lpf = output_ptr->lpf/10.0*(output_ptr->sample_index + 1);
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        float value = *log_stream_ptr->data_ptr;
+        log_stream_ptr->data_value = value;
+        log_stream_ptr->dc_value += dc_lpf*(value - log_stream_ptr->dc_value);
+        if(log_stream_ptr->mode == SERIAL_LOG_STREAM_PEAK)
+        {
+            if(value < log_stream_ptr->min_value)
+                log_stream_ptr->min_value = value;
+            if(value > log_stream_ptr->max_value)
+                log_stream_ptr->max_value = value;
+        }
+    }
+}
+
+/*
+ * follows the envelope of the raw value between store ticks
+ */
+static void track_envelope(log_stream_t *log_stream_ptr, float value)
+{
+    log_stream_ptr->min_value = (value < log_stream_ptr->min_value)?value:log_stream_ptr->min_value;
+    log_stream_ptr->max_value = (value > log_stream_ptr->max_value)?value:log_stream_ptr->max_value;
+}
+
+/*
+ * applies the low pass filters on all the streams of the log. The filter is picked once
+ * for the whole log so that every stream of the loop goes through the same code
+ */
+static void filter_output_data(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    log_stream_t **streams = STREAMS(log_ptr);
+    int stream_count = STREAM_COUNT(log_ptr);
+    float lpf = output_ptr->lpf;
+    float dc_lpf  = lpf/10.0;
+    switch(output_ptr->filter)
+    {
+    case SERIAL_LOG_FILTER_BUTTERWORTH:
+        for(j = 0; j < stream_count; ++j)
+        {
+            log_stream_t *log_stream_ptr = streams[j];
+            float value = *log_stream_ptr->data_ptr;
+            log_stream_ptr->data_value = filter_biquad(output_ptr, log_stream_ptr, value);
+            log_stream_ptr->dc_value = dc_lpf*value+(1-dc_lpf)*log_stream_ptr->dc_value;
+        }
+        break;
+
+    case SERIAL_LOG_FILTER_BUTTERWORTH_FIXED:
+        for(j = 0; j < stream_count; ++j)
+        {
+            log_stream_t *log_stream_ptr = streams[j];
+            float value = *log_stream_ptr->data_ptr;
+            log_stream_ptr->data_value = filter_biquad_fixed(output_ptr, log_stream_ptr, value);
+            log_stream_ptr->dc_value = dc_lpf*value+(1-dc_lpf)*log_stream_ptr->dc_value;
+        }
+        break;
+
+    case SERIAL_LOG_FILTER_BOXCAR:
+        for(j = 0; j < stream_count; ++j)
+        {
+            log_stream_t *log_stream_ptr = streams[j];
+            float value = *log_stream_ptr->data_ptr;
+            //the dc value follows the window means
+            filter_boxcar(output_ptr, log_stream_ptr, value, dc_lpf);
+        }
+        break;
+
+    default:
+        for(j = 0; j < stream_count; ++j)
+        {
+            log_stream_t *log_stream_ptr = streams[j];
+            float value = *log_stream_ptr->data_ptr;
+            log_stream_ptr->data_value = lpf*value+(1-lpf)*log_stream_ptr->data_value;
+            log_stream_ptr->dc_value = dc_lpf*value+(1-dc_lpf)*log_stream_ptr->dc_value;
+        }
+        break;
+    }
+    //only the logs with peak streams pay for the envelope
+    if(output_ptr->peak_stream_count == 0)
+        return;
+    for(j = 0; j < stream_count; ++j)
+    {
+        if(streams[j]->mode == SERIAL_LOG_STREAM_PEAK)
+            track_envelope(streams[j], *streams[j]->data_ptr);
+    }
+}
+
+/*
+ * adds the raw value of every stream to the statistics of the current window
+ */
+static void accumulate_statistics(log_t *log_ptr)
+{
+    int j;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        float value = *log_stream_ptr->data_ptr;
+        log_stream_ptr->sum += value;
+        log_stream_ptr->sum_of_squares += value*value;
+        log_stream_ptr->window_count++;
+        track_envelope(log_stream_ptr, value);
+    }
+}
+
+/*
+ * stores one statistics record per stream at the end of every window. The statistics
+ * are sent continuously so a window is dropped if there is no free buffer for it
+ */
+static void store_statistics(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    if(++output_ptr->sample_count <= output_ptr->sample_index)
+        return;
+    output_ptr->sample_count = 0;
+    output_ptr->store_count++;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        if(!log_data(log_stream_ptr, output_ptr->store_count-1))
+        {
+            //the window still has to be restarted
+            log_stream_ptr->sum = 0;
+            log_stream_ptr->sum_of_squares = 0;
+            log_stream_ptr->window_count = 0;
+            log_stream_ptr->min_value = FLT_MAX;
+            log_stream_ptr->max_value = -FLT_MAX;
+        }
+    }
+}
+
+/*
+ * stores a record in every stream when any of them moved beyond its deadband
+ * since the last record or when the heartbeat interval has passed
+ */
+static void store_events(log_t *log_ptr)
+{
+    int j;
+    bool changed = false;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    //sample count holds the ticks since the last record
+    if(output_ptr->sample_count < 0xFFFF)
+        output_ptr->sample_count++;
+    for(j = 0; j < STREAM_COUNT(log_ptr) && !changed; ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        float change = *log_stream_ptr->data_ptr - log_stream_ptr->data_value;
+        changed = (change > log_stream_ptr->deadband) || (-change > log_stream_ptr->deadband);
+    }
+    if(!changed && output_ptr->sample_count < output_ptr->sample_index)
+        return;
+
+    //the record is only stored once every stream has space for it. Otherwise it is
+    //tried again on the next tick with the delta still counting
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        if(!reserve_log_data(STREAMS(log_ptr)[j], output_ptr->store_count))
+            return;
+    }
+    output_ptr->store_count++;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        //the stored value is the one the next change is measured against
+        log_stream_ptr->data_value = *log_stream_ptr->data_ptr;
+        log_stream_ptr->event_delta = output_ptr->sample_count;
+        log_data(log_stream_ptr, output_ptr->store_count-1);
+    }
+    output_ptr->sample_count = 0;
+}
+
+/*
+ * claims a buffer for the next burst of every stream and runs the trigger on the
+ * raw value of the source stream. Nothing is claimed during the burst itself
+ */
+static void prepare_burst(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    float dc_lpf = output_ptr->lpf/10.0;
+
+    if(!output_ptr->burst_ready)
+    {
+        output_ptr->burst_ready = true;
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+            if(log_stream_ptr->active_stream_data_ptr != NULL)
+                continue;
+            if(!init_active_stream_data_buffer(log_stream_ptr, 0))
+                output_ptr->burst_ready = false;
+        }
+    }
+    if(output_ptr->trigger.source_stream < STREAM_COUNT(log_ptr))
+    {
+        log_stream_t *source_ptr = STREAMS(log_ptr)[output_ptr->trigger.source_stream];
+        source_ptr->data_value = *source_ptr->data_ptr;
+        source_ptr->dc_value = dc_lpf*source_ptr->data_value+(1-dc_lpf)*source_ptr->dc_value;
+    }
+    update_trigger_state(log_ptr);
+}
+
+/*
+ * copies the raw value of every stream into its burst buffer. The buffers are handed
+ * over to the stream layer as soon as the burst is complete
+ */
+static void store_burst(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    uint16_t position = output_ptr->store_count;
+
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        log_stream_ptr->active_stream_data_ptr->data_ptr[position] = get_value_bits(log_stream_ptr, *log_stream_ptr->data_ptr);
+    }
+    if(++output_ptr->store_count < output_ptr->burst_length)
+        return;
+
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        log_stream_ptr->active_stream_data_ptr->data_bits = log_stream_ptr->max_bit_count;
+        log_stream_ptr->active_stream_data_ptr->capture_id = output_ptr->capture_id;
+        //the buffer was claimed before the trigger but the burst starts on the trigger tick
+        log_stream_ptr->active_stream_data_ptr->sample_tick = output_ptr->capture_tick;
+        log_stream_ptr->active_stream_data_ptr->state = SERIAL_LOG_DATA_READY;
+        log_stream_ptr->active_stream_data_ptr = NULL;
+    }
+    output_ptr->burst_ready = false;
+    output_ptr->trigger_state = TRIGGER_WAIT_FOR_ARM;
+}
+
+/*
+ * claims the buffers that the main loop writes the spectra into. The pool is only used
+ * by the sampling side of its sample group so the buffers are taken here and not in the main loop
+ */
+static bool reserve_spectrum_buffers(log_t *log_ptr)
+{
+    int j;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        if(log_stream_ptr != NULL && !init_active_stream_data_buffer(log_stream_ptr, 0))
+        {
+            break;
+        }
+    }
+    if(j == STREAM_COUNT(log_ptr))
+    {
+        return true;
+    }
+    while(--j >= 0)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        if(log_stream_ptr == NULL)
+            continue;
+        drop_stream_data_buffer(log_stream_ptr, log_stream_ptr->active_stream_data_ptr);
+        log_stream_ptr->active_stream_data_ptr = NULL;
+    }
+    log_ptr->type.output.dropped_spectra++;
+    return false;
+}
+
+/*
+ * stores the decimated samples either into the capture or into the
+ * circular history while the log is waiting for a trigger
+ */
+static void store_output_data(log_t *log_ptr)
+{
+    int j;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    log_trigger_state_t log_state = output_ptr->trigger_state;
+
+    if(log_state == TRIGGER_ACTIVE)
+    {
+        //store data if the sample count reached the store count
+        if(++output_ptr->sample_count <= output_ptr->sample_index)
+            return;
+        output_ptr->sample_count = 0;
+        output_ptr->store_count++;
+        if(output_ptr->store_count > 1024)
+        {
+            log_state = TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY;
+        }
+        else if(output_ptr->mode == LOG_OUTPUT_SPECTRUM)
+        {
+            //spectrum captures are kept as floats until the main loop transforms them
+            for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+            {
+                log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+                log_stream_ptr->spectrum_ptr[output_ptr->store_count-1] = log_stream_ptr->data_value;
+            }
+            if(output_ptr->store_count >= output_ptr->fft_size)
+            {
+                //without buffers for every stream the spectrum is dropped and captured again
+                log_state = reserve_spectrum_buffers(log_ptr)?TRIGGER_WAIT_FOR_SPECTRUM:TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY;
+            }
+        }
+        else
+        {
+            for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+            {
+                log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+                if(!log_data(log_stream_ptr, output_ptr->store_count-1))
+                {
+                    //we ran out of space to send the data. So we have to drop this capture entirely
+                    //and send a new set of data.
+                    drop_output_data_buffers(log_ptr);
+                    log_state = TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW;
+                    break;
+                }
+            }
+        }
+        output_ptr->trigger_state = log_state;
+    }
+    else if(output_ptr->pre_trigger_count != 0 &&
+            (log_state == TRIGGER_WAIT_FOR_ARM || log_state == TRIGGER_ARMED))
+    {
+        //keep the decimated samples leading up to the trigger in the circular history
+        if(++output_ptr->sample_count <= output_ptr->sample_index)
+            return;
+        output_ptr->sample_count = 0;
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+            log_history_data(log_stream_ptr, output_ptr->history_index);
+        }
+        if(++output_ptr->history_index >= output_ptr->pre_trigger_count)
+        {
+            output_ptr->history_index = 0;
+            output_ptr->history_full = true;
+        }
+    }
+    else
+    {
+        //without a history the first interval of a capture only holds the trigger tick
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+            if(log_stream_ptr->mode != SERIAL_LOG_STREAM_PEAK)
+                continue;
+            log_stream_ptr->min_value = FLT_MAX;
+            log_stream_ptr->max_value = -FLT_MAX;
+        }
+    }
+}
+
+/*
+ * this is the function that samples all the output data and is called
+ * SAMPLING_RATE per second
+ */
+static void log_all_output_data(serial_log_instance_t *instance, uint8_t group)
+{
+    int i;
+    //the samples of this tick are stamped with the new count
+    instance->sample_ticks[group]++;
+    //the triggers of all the logs are evaluated before any data is stored so that
+    //every log of a trigger group stores its first sample on the same tick
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL)
+            continue;
+        if(log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.sample_group != group)
+            continue;
+        if(log_ptr->type.output.struct_ptr != NULL)
+            take_struct_snapshot(log_ptr);
+        switch(log_ptr->type.output.mode)
+        {
+        case LOG_OUTPUT_STATISTICS:
+            accumulate_statistics(log_ptr);
+            break;
+
+        case LOG_OUTPUT_EVENT:
+            //events only need the raw values when they are stored
+            break;
+
+        case LOG_OUTPUT_BURST:
+            if(log_ptr->type.output.trigger_state != TRIGGER_ACTIVE)
+                prepare_burst(log_ptr);
+            break;
+
+        default:
+            //derived logs are left for the next pass
+            if(log_ptr->type.output.derive_func != NULL)
+                break;
+            filter_output_data(log_ptr);
+            if(log_ptr->type.output.trigger_state != TRIGGER_ACTIVE)
+                update_trigger_state(log_ptr);
+            break;
+        }
+    }
+
+    //a derived log reads the filtered values of its source, which can sit in any slot of
+    //logs[] once slots are reused, so derived logs follow all the other logs
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL)
+            continue;
+        if(log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.sample_group != group ||
+           log_ptr->type.output.derive_func == NULL)
+            continue;
+        derive_output_data(log_ptr);
+        if(log_ptr->type.output.trigger_state != TRIGGER_ACTIVE)
+            update_trigger_state(log_ptr);
+    }
+
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL)
+            continue;
+        if(log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.sample_group != group)
+            continue;
+        switch(log_ptr->type.output.mode)
+        {
+        case LOG_OUTPUT_STATISTICS:
+            store_statistics(log_ptr);
+            break;
+
+        case LOG_OUTPUT_EVENT:
+            store_events(log_ptr);
+            break;
+
+        case LOG_OUTPUT_BURST:
+            if(log_ptr->type.output.trigger_state == TRIGGER_ACTIVE)
+                store_burst(log_ptr);
+            break;
+
+        default:
+            store_output_data(log_ptr);
+            break;
+        }
+    }
+}
+
+/*
+ * This function is expected to be called once every sampling tick.
+ */
+void serial_log_sample_data()
+{
+    log_all_output_data(&default_instance, 0);
+}
+
+void serial_log_sample_group_data(uint8_t group)
+{
+    serial_log_instance_sample_group_data(&default_instance, group);
+}
+
+void serial_log_instance_sample_data(serial_log_instance_t *instance)
+{
+    log_all_output_data(instance, 0);
+}
+
+void serial_log_instance_sample_group_data(serial_log_instance_t *instance, uint8_t group)
+{
+    if(group < MAX_SAMPLE_GROUPS)
+    {
+        log_all_output_data(instance, group);
+    }
+}
+
+#ifdef SERIAL_LOG_LINKER_TABLE
+//logs declared with SERIAL_LOG_REGISTER in any module. The linker collects them in the serial_log_table section
+extern const serial_log_static_t * const serial_log_table_start[];
+extern const serial_log_static_t * const serial_log_table_end[];
+
+/*
+ * registers every log of the linker table that is sampled by the group
+ */
+static void register_linked_logs(uint8_t group)
+{
+    const serial_log_static_t * const *entry_ptr;
+    uint8_t creation_group = selected_instance->sample_group;
+    selected_instance->sample_group = group;
+    for(entry_ptr = serial_log_table_start; entry_ptr < serial_log_table_end; ++entry_ptr)
+    {
+        if((*entry_ptr)->sample_group == group)
+        {
+            serial_log_output_static(*entry_ptr);
+        }
+    }
+    selected_instance->sample_group = creation_group;
+}
+#endif
+
+void serial_log_init_sample_group(uint8_t group, uint16_t sampling_rate_in_hz)
+{
+    if(group < MAX_SAMPLE_GROUPS && sampling_rate_in_hz != 0)
+    {
+        selected_instance->sampling_rates[group] = sampling_rate_in_hz;
+        #ifdef SERIAL_LOG_LINKER_TABLE
+          register_linked_logs(group);
+        #endif
+    }
+}
+
+bool serial_log_use_sample_group(uint8_t group)
+{
+    if(group >= MAX_SAMPLE_GROUPS || selected_instance->sampling_rates[group] == 0)
+    {
+        return false;
+    }
+    selected_instance->sample_group = group;
+    return true;
+}
+
+/*
+ * writes the magnitude spectrum of the stream into the buffer that the ISR reserved as the
+ * full scale amplitude and the bin width followed by the bins quantized to 16 bits
+ */
+static void store_spectrum(log_t *log_ptr, log_stream_t *log_stream_ptr)
+{
+    uint16_t k;
+    float full_scale = 0;
+    float scale = 0;
+    log_output_t *output_ptr = &log_ptr->type.output;
+    float bin_width = (float)log_ptr->instance->sampling_rates[output_ptr->sample_group]/((float)(output_ptr->sample_index + 1)*output_ptr->fft_size);
+    log_stream_data_t *log_stream_data_ptr = log_stream_ptr->active_stream_data_ptr;
+
+    serial_log_spectrum_magnitude(log_stream_ptr->spectrum_ptr, output_ptr->twiddle_ptr, output_ptr->fft_size);
+    for(k = 0; k < output_ptr->bin_count; ++k)
+    {
+        if(log_stream_ptr->spectrum_ptr[k] > full_scale)
+            full_scale = log_stream_ptr->spectrum_ptr[k];
+    }
+    if(full_scale > 0)
+    {
+        scale = 65535.0f/full_scale;
+    }
+    store_data_bits(get_value_bits(log_stream_ptr, full_scale), log_stream_data_ptr->data_ptr, 0, 32);
+    store_data_bits(get_value_bits(log_stream_ptr, bin_width), log_stream_data_ptr->data_ptr, 32, 32);
+    for(k = 0; k < output_ptr->bin_count; ++k)
+    {
+        uint32_t bin = (uint32_t)(log_stream_ptr->spectrum_ptr[k]*scale + 0.5f);
+        store_data_bits(bin, log_stream_data_ptr->data_ptr, 64 + (uint32_t)k*16, 16);
+    }
+    log_stream_data_ptr->data_bits = 64 + (uint32_t)output_ptr->bin_count*16;
+    log_stream_data_ptr->data_offset = 0;
+    log_stream_data_ptr->trigger_position = 0;
+    log_stream_data_ptr->history_start = 0;
+    log_stream_data_ptr->capture_id = log_stream_ptr->capture_id;
+    log_stream_data_ptr->sample_tick = output_ptr->capture_tick;
+    log_stream_data_ptr->compressed = false;
+}
+
+/*
+ * computes the spectrum of a completed capture outside of the sampling ISR.
+ * Only one log is transformed per call to keep the main loop responsive
+ */
+static void compute_pending_spectrum(serial_log_instance_t *instance)
+{
+    int i, j;
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT)
+            continue;
+        if(log_ptr->type.output.trigger_state != TRIGGER_WAIT_FOR_SPECTRUM)
+            continue;
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            if(STREAMS(log_ptr)[j] != NULL)
+                store_spectrum(log_ptr, STREAMS(log_ptr)[j]);
+        }
+        //the ISR marks the buffers ready and starts a new capture once the spectra are sent
+        log_ptr->type.output.trigger_state = TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY;
+        return;
+    }
+}
+
+/*
+ * takes the oldest ready buffer of every stream away from the sampling side, which only
+ * drops buffers that are filling or ready. Returns false if a stream has no ready buffer
+ */
+static bool claim_ready_buffers(log_t *log_ptr, uint8_t *buffer_indexes)
+{
+    int j, k;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        int ready_index = -1;
+        for(k = 0; k < MAX_STREAM_BUFFER_SLOTS; ++k)
+        {
+            log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[k];
+            if(log_stream_data_ptr != NULL && log_stream_data_ptr->state == SERIAL_LOG_DATA_READY &&
+               (log_ptr->type.output.dropped_capture_id == 0 || log_stream_data_ptr->capture_id != log_ptr->type.output.dropped_capture_id) &&
+               (ready_index < 0 || (int16_t)(log_stream_data_ptr->sequence - log_stream_ptr->buffers[ready_index]->sequence) < 0))
+            {
+                ready_index = k;
+            }
+        }
+        if(ready_index < 0)
+            return false;
+        buffer_indexes[j] = (uint8_t)ready_index;
+    }
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        STREAMS(log_ptr)[j]->buffers[buffer_indexes[j]]->state = SERIAL_LOG_COMPRESSED_DATA_FILLING;
+    }
+    return true;
+}
+
+/*
+ * replaces the samples of the buffer with their compressed bits if that makes it smaller
+ */
+static void compress_buffer(uint32_t *compress_ptr, log_stream_data_t *log_stream_data_ptr)
+{
+    uint32_t sample_count = log_stream_data_ptr->data_bits/SERIAL_LOG_BYTES_TO_BITS(sizeof(uint32_t));
+    uint32_t bit_count = serial_log_compress_buffer(log_stream_data_ptr->data_ptr, sample_count, compress_ptr);
+    if(bit_count == 0)
+        return;
+    memcpy(log_stream_data_ptr->data_ptr, compress_ptr, ((bit_count + 31) >> 5)*sizeof(uint32_t));
+    log_stream_data_ptr->data_bits = bit_count;
+    log_stream_data_ptr->sample_count = sample_count;
+    log_stream_data_ptr->compressed = true;
+}
+
+/*
+ * compresses the ready buffers of the logs that have compression enabled so that the ISR only
+ * stores plain samples. A set of one buffer of every stream is compressed per call, which the
+ * stream layer then sends as it would send the plain set
+ */
+static void compress_ready_buffers(serial_log_instance_t *instance)
+{
+    int i, j;
+    for(i = 0; i < MAX_LOGS; ++i)
+    {
+        log_t *log_ptr = instance->logs[i];
+        if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || !serial_log_stream_is_compressed(&instance->stream, log_ptr))
+            continue;
+        if(!claim_ready_buffers(log_ptr, instance->compress_buffers))
+            continue;
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+            log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[instance->compress_buffers[j]];
+            //only streams with a single value per sample are compressed
+            if(log_stream_ptr->mode == SERIAL_LOG_STREAM_SAMPLE)
+                compress_buffer(log_ptr->type.output.compress_ptr, log_stream_data_ptr);
+            log_stream_data_ptr->state = SERIAL_LOG_COMPRESSED_DATA_READY;
+        }
+        return;
+    }
+}
+
+/*
+ * This function is expected to be called in the main loop
+ */
+void serial_log_handler(uint32_t in_current_ms)
+{
+    serial_log_instance_handler(&default_instance, in_current_ms);
+}
+
+void serial_log_instance_handler(serial_log_instance_t *instance, uint32_t in_current_ms)
+{
+    release_closed_logs(instance);
+    compute_pending_spectrum(instance);
+    compress_ready_buffers(instance);
+    serial_log_stream_handler(&instance->stream, in_current_ms);
+}
+
+
+#if 0
+/*
+ * array of data to be stored, one for each stream
+ */
+bool serial_log_data(void *log_input_ptr,...)
+{
+    int i;
+    va_list stream_data_list;
+    bool ret = true;
+    log_t *log_ptr = (log_t *)log_input_ptr;
+    if(log_ptr == NULL)
+    {
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        //we don't have space for new stream
+        return false;
+    }
+    va_start(stream_data_list, log_input_ptr);
+    //for(i = 0; i < log_ptr->type.output.stream_count&&ret; ++i)
+    for(i = 0; i < STREAM_COUNT(log_ptr)&&ret; ++i)
+    {
+        float data;
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[i];//log_ptr->type.output.streams[i];
+        data = va_arg(stream_data_list, float);
+        ret = log_data(log_stream_ptr, data);
+    }
+    va_end(stream_data_list);
+    return ret;
+}
+#endif
+
+/*
+ * sets up an instance without any logs that uses the buffer for its logs
+ */
+static void init_instance(serial_log_instance_t *instance, void *buffer, uint32_t buffer_size, uint16_t sampling_rate_in_hz,
+                          const serial_log_link_t *link)
+{
+    memset(instance, 0, sizeof(serial_log_instance_t));
+    serial_log_memory_init(&instance->memory, buffer, buffer_size);
+    instance->sampling_rates[0] = sampling_rate_in_hz;
+    instance->storage_time = STORAGE_TIME_IN_MS;
+    instance->reserved_buffers = MAX_STREAM_DATA_BUFFERS;
+    //timer_ticks = (1000 + sampling_rate/2)/sampling_rate;
+    serial_log_stream_handler_init(&instance->stream, instance->logs, link);
+    if(link == NULL)
+    {
+        serial_log_uart_init();
+    }
+}
+
+/*
+ * This is the total memory available for logging data
+ */
+void serial_log_init(void *buffer, uint32_t buffer_size, uint16_t sampling_rate_in_hz)
+{
+    init_instance(&default_instance, buffer, buffer_size, sampling_rate_in_hz, NULL);
+    selected_instance = &default_instance;
+    #ifdef SERIAL_LOG_LINKER_TABLE
+      register_linked_logs(0);
+    #endif
+}
+
+uint32_t serial_log_plan_instance(void)
+{
+    return adjust_memory_length(sizeof(serial_log_instance_t))*sizeof(int);
+}
+
+serial_log_instance_t *serial_log_init_instance(void *buffer, uint32_t buffer_size, uint16_t sampling_rate_in_hz,
+                                                const serial_log_link_t *link)
+{
+    serial_log_instance_t *instance = (serial_log_instance_t *)buffer;
+    uint32_t length = serial_log_plan_instance();
+    if(buffer == NULL || buffer_size < length)
+    {
+        return NULL;
+    }
+    init_instance(instance, (int *)buffer + length/sizeof(int), buffer_size - length, sampling_rate_in_hz, link);
+    return instance;
+}
+
+void serial_log_use_instance(serial_log_instance_t *instance)
+{
+    selected_instance = (instance != NULL)?instance:&default_instance;
+}
+
+
+/*
+ * sets up an output log whose streams are in place to store a sample every store_period sampling ticks
+ */
+static void init_output_log(log_t *log_ptr, log_output_mode_t mode, const serial_log_trigger_t *trigger, uint16_t store_period)
+{
+    int j;
+    configure_trigger(log_ptr, (trigger != NULL)?trigger:&default_trigger);
+
+    log_ptr->type.output.mode = mode;
+    log_ptr->type.output.sample_group = selected_instance->sample_group;
+    log_ptr->type.output.sample_count = 0;
+    log_ptr->type.output.sample_index = store_period;
+    log_ptr->type.output.compress = false;
+    log_ptr->type.output.compress_ptr = NULL;
+    log_ptr->type.output.peak_stream_count = 0;
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        if(STREAMS(log_ptr)[j]->mode == SERIAL_LOG_STREAM_PEAK)
+            log_ptr->type.output.peak_stream_count++;
+    }
+}
+
+/*
+ * creates an output log that stores a sample every store_period sampling ticks. The creator
+ * finishes setting it up and then puts it in logs[] with publish_log
+ */
+static log_t *create_output_log(const char * title, log_output_mode_t mode, const serial_log_trigger_t *trigger,
+                                int stream_count, const serial_log_stream_t *streams, uint16_t store_period, uint16_t samples_per_buffer)
+{
+    int i, j;
+    uint32_t memory_size_per_buffer;
+    log_t *log_ptr;
+
+    log_ptr = allocate_log_ptr((char *)title);
+    if(log_ptr == NULL)
+    {
+        //we ran out of memory
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        return NULL;
+    }
+
+    log_ptr->direction = LOG_OUTPUT;
+    stream_count = (stream_count < MAX_LOG_STREAM_COUNT)?stream_count:MAX_LOG_STREAM_COUNT;
+    //the stream pointers start out as NULL
+    STREAMS(log_ptr) = (log_stream_t **)allocate_memory(adjust_memory_length(stream_count*sizeof(log_stream_t *)));
+    if(STREAMS(log_ptr) == NULL)
+    {
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        discard_log(log_ptr);
+        return NULL;
+    }
+
+    for(i = 0; i < stream_count; ++i)
+    {
+        STREAMS(log_ptr)[i] = allocate_new_log_stream(&streams[i], get_stream_mode(mode, streams[i].mode));
+        if(STREAMS(log_ptr)[i] == NULL)
+        {
+            //we ran out of memory
+            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+            STREAM_COUNT(log_ptr) = i;
+            discard_log(log_ptr);
+            return NULL;
+        }
+        //STREAMS(log_ptr)[i] = log_stream_ptr;
+    }
+    STREAM_COUNT(log_ptr) = stream_count;
+    init_output_log(log_ptr, mode, trigger, store_period);
+    //Now allocate space for storing the data. We will allocate enough space to
+    //store data for storage_time. So at 1000Hz sampling rate and 100ms that will be 100 float units of space
+    memory_size_per_buffer = get_samples_per_buffer(mode, selected_instance->sampling_rates[selected_instance->sample_group], store_period,
+                                                    samples_per_buffer, selected_instance->storage_time);
+    //memory_size_per_buffer&=(~(uint32_t)(sizeof(uint32_t)-1)); //make sure that the buffer_size is divisible by uint32_t data type
+
+    for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[i];
+        log_stream_ptr->max_bit_count = (uint32_t)log_stream_ptr->type_length_in_bits*memory_size_per_buffer;//SERIAL_LOG_BYTES_TO_BITS(memory_size_per_buffer); //number of bits that we can store
+        for(j = 0; j < log_stream_ptr->reserved_count; ++j)
+        {
+            int *memory;
+            log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[j];
+            memory = allocate_memory(adjust_memory_length(SERIAL_LOG_BITS_TO_BYTES(log_stream_ptr->max_bit_count)));
+            if(memory == NULL)
+            {
+                error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+                discard_log(log_ptr);
+                return NULL;
+            }
+            log_stream_data_ptr->data_ptr = (uint32_t *)memory;
+        }
+    }
+
+    return log_ptr;
+}
+
+/*
+ * computes the coefficients of every anti-alias filter of the log for its bandwidth
+ * so that the filters can be switched without any trigonometry
+ */
+static void set_output_bandwidth(log_t *log_ptr, uint16_t bandwidth_in_hz)
+{
+    int i;
+    float *biquad = log_ptr->type.output.biquad;
+    //bilinear transform of the butterworth prototype with a quality factor of 1/sqrt(2)
+    uint16_t sampling_rate = log_ptr->instance->sampling_rates[log_ptr->type.output.sample_group];
+    float k = tanf(3.14159265f*bandwidth_in_hz/sampling_rate);
+    float norm = 1.0f/(1.0f + 1.41421356f*k + k*k);
+
+    log_ptr->type.output.lpf = (float)bandwidth_in_hz/(2*3.14*sampling_rate);
+    biquad[0] = k*k*norm;
+    biquad[1] = 2.0f*biquad[0];
+    biquad[2] = biquad[0];
+    biquad[3] = 2.0f*(k*k - 1.0f)*norm;
+    biquad[4] = (1.0f - 1.41421356f*k + k*k)*norm;
+    for(i = 0; i < 5; ++i)
+    {
+        log_ptr->type.output.biquad_fixed[i] = (int32_t)(biquad[i]*(float)(1UL << BIQUAD_FIXED_SHIFT) + ((biquad[i] < 0)?-0.5f:0.5f));
+    }
+}
+
+/*
+ * creates an output log that captures the low pass filtered waveform of its streams
+ */
+static log_t *create_capture_log(const char * title, uint16_t bandwidth_in_hz, const serial_log_trigger_t *trigger, int stream_count, const serial_log_stream_t *streams)
+{
+    uint16_t sample_index = get_capture_sample_index(selected_instance->sampling_rates[selected_instance->sample_group], bandwidth_in_hz);
+    log_t *log_ptr = create_output_log(title, LOG_OUTPUT_CAPTURE, trigger, stream_count, streams, sample_index, 0);
+    if(log_ptr != NULL)
+    {
+        set_output_bandwidth(log_ptr, bandwidth_in_hz);
+    }
+    return log_ptr;
+}
+
+/*
+ * keeps a circular history of the last sample_count decimated samples while the log
+ * is waiting for a trigger. The history is limited to a single data buffer.
+ */
+void serial_log_set_pre_trigger(void *log_output_ptr, uint16_t sample_count)
+{
+    uint16_t max_sample_count;
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || STREAM_COUNT(log_ptr) == 0)
+    {
+        return;
+    }
+    if(log_ptr->type.output.mode != LOG_OUTPUT_CAPTURE)
+    {
+        return;
+    }
+    max_sample_count = STREAMS(log_ptr)[0]->max_bit_count/STREAMS(log_ptr)[0]->type_length_in_bits;
+    log_ptr->type.output.pre_trigger_count = (sample_count < max_sample_count)?sample_count:max_sample_count;
+    reset_history(log_ptr);
+}
+
+/*
+ * reads the name and data pointer pairs passed to serial_log_output
+ */
+static int read_stream_list(serial_log_stream_t *streams, int stream_count, va_list stream_list)
+{
+    int i;
+    stream_count = (stream_count < MAX_LOG_ARG_STREAM_COUNT)?stream_count:MAX_LOG_ARG_STREAM_COUNT;
+    for(i = 0; i < stream_count; ++i)
+    {
+        streams[i].name = va_arg( stream_list, const char *);
+        streams[i].data_ptr = va_arg( stream_list, float *);
+        streams[i].mode = SERIAL_LOG_STREAM_SAMPLE;
+        streams[i].deadband = 0;
+    }
+    return stream_count;
+}
+
+void *serial_log_output(const char * title, uint16_t bandwidth_in_hz, int stream_count,...)
+{
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    va_list stream_list;
+
+    va_start( stream_list, stream_count );
+    stream_count = read_stream_list(streams, stream_count, stream_list);
+    va_end(stream_list);
+    return publish_log(create_capture_log(title, bandwidth_in_hz, NULL, stream_count, streams));
+}
+
+void *serial_log_output_triggered(const char * title, uint16_t bandwidth_in_hz, const serial_log_trigger_t *trigger, int stream_count,...)
+{
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    va_list stream_list;
+
+    va_start( stream_list, stream_count );
+    stream_count = read_stream_list(streams, stream_count, stream_list);
+    va_end(stream_list);
+    return publish_log(create_capture_log(title, bandwidth_in_hz, trigger, stream_count, streams));
+}
+
+void *serial_log_output_streams(const char * title, uint16_t bandwidth_in_hz, const serial_log_trigger_t *trigger, int stream_count, const serial_log_stream_t *streams)
+{
+    return publish_log(create_capture_log(title, bandwidth_in_hz, trigger, stream_count, streams));
+}
+
+/*
+ * gets the size of a struct field of the given type
+ */
+static size_t get_field_size(log_field_type_t type)
+{
+    switch(type)
+    {
+    case SERIAL_LOG_FIELD_INT16:
+        return sizeof(int16_t);
+
+    case SERIAL_LOG_FIELD_UINT16:
+        return sizeof(uint16_t);
+
+    case SERIAL_LOG_FIELD_INT32:
+        return sizeof(int32_t);
+
+    case SERIAL_LOG_FIELD_UINT32:
+        return sizeof(uint32_t);
+
+    default:
+        return sizeof(float);
+    }
+}
+
+void *serial_log_output_struct(const char * title, uint16_t bandwidth_in_hz, const volatile void *struct_ptr, size_t struct_size,
+                               int field_count, const serial_log_field_t *fields)
+{
+    serial_log_stream_t streams[MAX_LOG_STREAM_COUNT];
+    log_t *log_ptr;
+    char *snapshot_ptr;
+    float *converted_ptr;
+    int i;
+
+    if(field_count <= 0 || fields == NULL)
+    {
+        return NULL;
+    }
+    //the fields come from an array so the log can be as wide as the ones from a stream table
+    field_count = (field_count < MAX_LOG_STREAM_COUNT)?field_count:MAX_LOG_STREAM_COUNT;
+    for(i = 0; i < field_count; ++i)
+    {
+        //every field is read from the copy of the struct, so it has to lie inside it
+        if(fields[i].offset > struct_size || get_field_size(fields[i].type) > struct_size - fields[i].offset)
+        {
+            return NULL;
+        }
+    }
+    //the converted values follow the copy of the struct
+    struct_size = (struct_size + sizeof(float) - 1)/sizeof(float)*sizeof(float);
+    snapshot_ptr = (char *)allocate_memory(adjust_memory_length(struct_size + field_count*sizeof(float)));
+    if(snapshot_ptr == NULL)
+    {
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        return NULL;
+    }
+    converted_ptr = (float *)(snapshot_ptr + struct_size);
+    for(i = 0; i < field_count; ++i)
+    {
+        streams[i].name = fields[i].name;
+        streams[i].data_ptr = (fields[i].type == SERIAL_LOG_FIELD_FLOAT)?(float *)(snapshot_ptr + fields[i].offset):&converted_ptr[i];
+        streams[i].mode = SERIAL_LOG_STREAM_SAMPLE;
+        streams[i].deadband = 0;
+    }
+    log_ptr = create_capture_log(title, bandwidth_in_hz, NULL, field_count, streams);
+    if(log_ptr == NULL)
+    {
+        serial_log_memory_free(&selected_instance->memory, snapshot_ptr);
+        return NULL;
+    }
+    for(i = 0; i < field_count; ++i)
+    {
+        STREAMS(log_ptr)[i]->field_type = fields[i].type;
+        STREAMS(log_ptr)[i]->field_offset = fields[i].offset;
+    }
+    log_ptr->type.output.snapshot_ptr = snapshot_ptr;
+    log_ptr->type.output.struct_size = struct_size;
+    log_ptr->type.output.struct_ptr = struct_ptr;
+    return publish_log(log_ptr);
+}
+
+void *serial_log_output_derived(const char * title, void *source_log_ptr, serial_log_derive_t derive_func, void *context, int stream_count,...)
+{
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    log_t *source_ptr = (log_t *)source_log_ptr;
+    log_t *log_ptr;
+    float *values;
+    va_list stream_list;
+    int i;
+
+    //derived logs are all computed in the same pass, so they cannot be derived from each other
+    if(source_ptr == NULL || source_ptr->direction != LOG_OUTPUT || source_ptr->type.output.mode != LOG_OUTPUT_CAPTURE ||
+       source_ptr->type.output.derive_func != NULL ||
+       source_ptr->instance != selected_instance || source_ptr->type.output.sample_group != selected_instance->sample_group ||
+       derive_func == NULL)
+    {
+        return NULL;
+    }
+    stream_count = (stream_count < MAX_LOG_ARG_STREAM_COUNT)?stream_count:MAX_LOG_ARG_STREAM_COUNT;
+    //the derived values are followed by a copy of the source values so that the ISR does not keep them on its stack
+    values = (float *)allocate_memory(adjust_memory_length((stream_count + STREAM_COUNT(source_ptr))*sizeof(float)));
+    if(values == NULL)
+    {
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        return NULL;
+    }
+    va_start( stream_list, stream_count );
+    for(i = 0; i < stream_count; ++i)
+    {
+        streams[i].name = va_arg( stream_list, const char *);
+        streams[i].data_ptr = &values[i];
+        streams[i].mode = SERIAL_LOG_STREAM_SAMPLE;
+        streams[i].deadband = 0;
+    }
+    va_end(stream_list);
+
+    log_ptr = create_output_log(title, LOG_OUTPUT_CAPTURE, NULL, stream_count, streams, source_ptr->type.output.sample_index, 0);
+    if(log_ptr == NULL)
+    {
+        serial_log_memory_free(&selected_instance->memory, values);
+        return NULL;
+    }
+    log_ptr->type.output.lpf = source_ptr->type.output.lpf;
+    log_ptr->type.output.source_log = source_ptr;
+    log_ptr->type.output.derive_context = context;
+    log_ptr->type.output.derived_values = values;
+    log_ptr->type.output.source_values = &values[stream_count];
+    log_ptr->type.output.derive_func = derive_func;
+    return publish_log(log_ptr);
+}
+
+void *serial_log_output_burst(const char * title, uint16_t burst_length, const serial_log_trigger_t *trigger, int stream_count,...)
+{
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    va_list stream_list;
+    log_t *log_ptr;
+
+    if(burst_length == 0)
+    {
+        return NULL;
+    }
+    va_start( stream_list, stream_count );
+    stream_count = read_stream_list(streams, stream_count, stream_list);
+    va_end(stream_list);
+    //every buffer holds a complete burst
+    log_ptr = create_output_log(title, LOG_OUTPUT_BURST, trigger, stream_count, streams, 1, burst_length);
+    if(log_ptr == NULL)
+    {
+        return NULL;
+    }
+    //the dc value of the trigger follows the raw value as if the log had the full bandwidth
+    log_ptr->type.output.lpf = 1/(4*3.14);
+    log_ptr->type.output.sample_index = 0;
+    log_ptr->type.output.burst_length = burst_length;
+    return publish_log(log_ptr);
+}
+
+void *serial_log_output_statistics(const char * title, uint16_t window_ticks, int stream_count,...)
+{
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    va_list stream_list;
+
+    va_start( stream_list, stream_count );
+    stream_count = read_stream_list(streams, stream_count, stream_list);
+    va_end(stream_list);
+    if(window_ticks == 0)
+    {
+        return NULL;
+    }
+    //a record is stored when the sample count goes past the sample index
+    return publish_log(create_output_log(title, LOG_OUTPUT_STATISTICS, NULL, stream_count, streams, window_ticks - 1, 0));
+}
+
+void *serial_log_output_spectrum(const char * title, uint16_t bandwidth_in_hz, uint16_t fft_size, int stream_count,...)
+{
+    //spectrum logs do not need to be aligned to a trigger
+    static const serial_log_trigger_t free_run_trigger = {SERIAL_LOG_TRIGGER_FREE_RUN, SERIAL_LOG_TRIGGER_RISING, 0, 0, 0, 0};
+    serial_log_stream_t streams[MAX_LOG_ARG_STREAM_COUNT];
+    va_list stream_list;
+    log_t *log_ptr;
+    int i, length;
+    uint16_t sample_index;
+
+    va_start( stream_list, stream_count );
+    stream_count = read_stream_list(streams, stream_count, stream_list);
+    va_end(stream_list);
+
+    fft_size = serial_log_spectrum_size(fft_size);
+    sample_index = get_capture_sample_index(selected_instance->sampling_rates[selected_instance->sample_group], bandwidth_in_hz);
+    //every buffer holds a single spectrum. The full scale and bin width take up the room of 4 bins
+    log_ptr = create_output_log(title, LOG_OUTPUT_SPECTRUM, &free_run_trigger, stream_count, streams, sample_index, fft_size/2 + 4);
+    if(log_ptr == NULL)
+    {
+        return NULL;
+    }
+    set_output_bandwidth(log_ptr, bandwidth_in_hz);
+    log_ptr->type.output.fft_size = fft_size;
+    log_ptr->type.output.bin_count = fft_size/2;
+
+    //the twiddle table and the samples of every stream are sized once here
+    length = adjust_memory_length(fft_size*sizeof(float));
+    log_ptr->type.output.twiddle_ptr = (float *)allocate_memory(length);
+    if(log_ptr->type.output.twiddle_ptr == NULL)
+    {
+        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+        discard_log(log_ptr);
+        return NULL;
+    }
+    serial_log_spectrum_init_twiddles(log_ptr->type.output.twiddle_ptr, fft_size);
+    for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+    {
+        STREAMS(log_ptr)[i]->spectrum_ptr = (float *)allocate_memory(length);
+        if(STREAMS(log_ptr)[i]->spectrum_ptr == NULL)
+        {
+            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+            discard_log(log_ptr);
+            return NULL;
+        }
+    }
+    return publish_log(log_ptr);
+}
+
+void *serial_log_output_events(const char * title, uint16_t heartbeat_ticks, int stream_count, const serial_log_stream_t *streams)
+{
+    log_t *log_ptr;
+    if(heartbeat_ticks == 0)
+    {
+        heartbeat_ticks = 0xFFFF;
+    }
+    //buffers are sized for the heartbeat rate but hold a minimum number of records for bursts of changes
+    log_ptr = create_output_log(title, LOG_OUTPUT_EVENT, NULL, stream_count, streams, heartbeat_ticks, 0);
+    if(log_ptr != NULL)
+    {
+        //the first tick always stores a record
+        log_ptr->type.output.sample_count = heartbeat_ticks;
+    }
+    return publish_log(log_ptr);
+}
+
+void *serial_log_output_static(const serial_log_static_t *static_ptr)
+{
+    int i, j;
+    log_t *log_ptr = static_ptr->log_ptr;
+    int stream_count = (static_ptr->stream_count < MAX_LOG_STREAM_COUNT)?static_ptr->stream_count:MAX_LOG_STREAM_COUNT;
+    int index = find_free_log_space_index();
+    if(index == INVALID_LOG_INDEX)
+    {
+        error_code = STREAM_LOG_ERR_MAX_LOGS_REACHED;
+        return NULL;
+    }
+    //the storage can only be used again once the log was closed and released
+    if(log_ptr->instance != NULL)
+    {
+        return NULL;
+    }
+    memset(log_ptr, 0, sizeof(log_t));
+    log_ptr->static_log = true;
+    log_ptr->title = (char *)static_ptr->title;
+    log_ptr->direction = LOG_OUTPUT;
+    STREAMS(log_ptr) = static_ptr->stream_ptrs;
+    STREAM_COUNT(log_ptr) = stream_count;
+    for(i = 0; i < stream_count; ++i)
+    {
+        log_stream_t *log_stream_ptr = &static_ptr->log_streams[i];
+        log_stream_mode_t mode = static_ptr->streams[i].mode;
+        if(get_type_length_in_bits(mode) > SERIAL_LOG_BYTES_TO_BITS(sizeof(uint32_t)))
+        {
+            //the storage only has a single word for every sample
+            return NULL;
+        }
+        memset(log_stream_ptr, 0, sizeof(log_stream_t));
+        log_stream_ptr->reserved_count = MAX_STREAM_DATA_BUFFERS;
+        log_stream_ptr->name = (char *)static_ptr->streams[i].name;
+        for(j = 0; j < MAX_STREAM_DATA_BUFFERS; ++j)
         {
-            if(log_stream_ptr->buffers[i]->state != SERIAL_LOG_DATA_NOT_SET)
-            {
-                in_transit = true;
-                break;
-            }
+            log_stream_data_t *log_stream_data_ptr = &static_ptr->buffers[i*MAX_STREAM_DATA_BUFFERS + j];
+            memset(log_stream_data_ptr, 0, sizeof(log_stream_data_t));
+            log_stream_data_ptr->data_ptr = &static_ptr->data[(uint32_t)(i*MAX_STREAM_DATA_BUFFERS + j)*static_ptr->samples_per_buffer];
+            log_stream_ptr->buffers[j] = log_stream_data_ptr;
         }
+        init_log_stream(log_stream_ptr, &static_ptr->streams[i], mode);
+        log_stream_ptr->max_bit_count = (uint32_t)log_stream_ptr->type_length_in_bits*static_ptr->samples_per_buffer;
+        STREAMS(log_ptr)[i] = log_stream_ptr;
     }
-    return in_transit;
+    log_ptr->instance = selected_instance;
+    init_output_log(log_ptr, LOG_OUTPUT_CAPTURE, NULL, get_capture_sample_index(selected_instance->sampling_rates[selected_instance->sample_group], static_ptr->bandwidth_in_hz));
+    set_output_bandwidth(log_ptr, static_ptr->bandwidth_in_hz);
+    //the sampling side only sees the log once it is complete
+    selected_instance->logs[index] = log_ptr;
+    return log_ptr;
 }
 
-
 /*
- * returns false if all the data buffers for every stream is not transmitting.
- * else it return true indicating a data buffer is in transit for this output log
+ * number of own buffers of every stream, 0 for the default
  */
-static bool reset_output_data_buffers(log_t *log_ptr)
+static uint8_t get_reserved_buffers(uint8_t buffer_count)
 {
-    int i,j;
-    bool in_transit = false;
-    //log_stream_ptr->active_stream_data_ptr = NULL;
-    for(j = 0; j < MAX_LOG_STREAM_COUNT; ++j)
+    if(buffer_count == 0 || buffer_count > MAX_STREAM_DATA_BUFFERS)
     {
-        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
-        if(log_stream_ptr == NULL)
-            continue;
-        log_stream_ptr->active_stream_data_ptr = NULL;
-        for(i = 0; i < MAX_STREAM_DATA_BUFFERS; ++i)
-        {
-            if(log_stream_ptr->buffers[i]->state != SERIAL_LOG_DATA_TRANSMITTING)
-            {
-                log_stream_ptr->buffers[i]->state = SERIAL_LOG_DATA_NOT_SET;
-            }
-            else
-                in_transit = true;
-        }
+        return MAX_STREAM_DATA_BUFFERS;
     }
-    return in_transit;
+    return buffer_count;
 }
 
-/*
- * this is the function that samples all the output data and is called
- * SAMPLING_RATE per second
- */
-static void log_all_output_data()
+void serial_log_set_reserved_buffers(uint8_t buffer_count)
 {
-    int i, j;
-    bool store_data = false;
-    //bool tx_buffer_active = true;
-    //check through all active logs to find output logs
-    for(i = 0; i < MAX_LOGS; ++i)
+    selected_instance->reserved_buffers = get_reserved_buffers(buffer_count);
+}
+
+bool serial_log_init_buffer_pool(uint16_t buffer_count, uint32_t buffer_size)
+{
+    uint32_t length = adjust_memory_length(buffer_size);
+    log_buffer_pool_t *pool_ptr = &selected_instance->pools[selected_instance->sample_group];
+    if(pool_ptr->buffer_count != 0 || buffer_count > MAX_POOL_BUFFERS)
     {
-        log_t *log_ptr = logs[i];
-        if(log_ptr == NULL)
-            continue;
-        if(log_ptr->direction != LOG_OUTPUT)
-            continue;
-        float lpf = log_ptr->type.output.lpf;
-        float dc_lpf  = lpf/10.0;
-        log_trigger_state_t log_state = log_ptr->type.output.trigger_state;
-        bool trigger_stream = true;
-        if(log_state == TRIGGER_ACTIVE)
-        {
-            //if we are storing data then there is no need for triggering
-            trigger_stream = false;
-            //store data if the sample count reached the store count
-            if(++log_ptr->type.output.sample_count > log_ptr->type.output.sample_index)
-            {
-                store_data = true;
-                log_ptr->type.output.sample_count = 0;
-            }
+        return false;
+    }
+    pool_ptr->max_bit_count = SERIAL_LOG_BYTES_TO_BITS(length*sizeof(int));
+    while(pool_ptr->buffer_count < buffer_count)
+    {
+        log_stream_data_t *log_stream_data_ptr = (log_stream_data_t *)allocate_memory(adjust_memory_length(sizeof(log_stream_data_t)));
+        if(log_stream_data_ptr == NULL)
+        {
+            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+            return false;
         }
-        //float trigger_value = 0;
-        float triggered = false;
-        for(j = 0; j < MAX_LOG_STREAM_COUNT; ++j)
+        log_stream_data_ptr->data_ptr = (uint32_t *)allocate_memory(length);
+        if(log_stream_data_ptr->data_ptr == NULL)
         {
-            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
-            if(log_stream_ptr == NULL)
-                continue;
-
-            //apply low pass filtering based on their bandwidth
-            log_stream_ptr->data_value = lpf*(*log_stream_ptr->data_ptr)+(1-lpf)*log_stream_ptr->data_value;
-            log_stream_ptr->dc_value = dc_lpf*(*log_stream_ptr->data_ptr)+(1-dc_lpf)*log_stream_ptr->data_value;
-            if(trigger_stream) //this is the first stream that will be used for triggering
-            {
-                //trigger_value = log_stream_ptr->data_value;
-                trigger_stream = false;
-                if(log_state == TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY)
-                {
-                    //we are waiting for all the buffers to be empty by sending them out to the host
-                    log_state = wait_output_data_buffers_empty(log_ptr)?TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY:TRIGGER_WAIT_FOR_NEGATIVE_TRANSITION;
-                }
-                if(log_state == TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW)
-                {
-                    //if a buffer was being sent out then we will wait for it.
-                    //all other filled buffers but not yet sent will be reset
-                    log_state = reset_output_data_buffers(log_ptr)?TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW:TRIGGER_WAIT_FOR_NEGATIVE_TRANSITION;
-                }
-                if(log_state == TRIGGER_WAIT_FOR_NEGATIVE_TRANSITION)
-                {
-                    //we want the value to dip below the dc value
-                    if(log_stream_ptr->data_value <= log_stream_ptr->dc_value)
-                    {
-                        log_state = TRIGGER_WAIT_FOR_POSITIVE_TRANSITION;
-                    }
-                }
-                if(log_state == TRIGGER_WAIT_FOR_POSITIVE_TRANSITION)
-                {
-                    //we want the value to plunge above the dc value
-                    if(log_stream_ptr->data_value > log_stream_ptr->dc_value)
-                    {
-                        log_state = TRIGGER_ACTIVE;
-                        log_ptr->type.output.sample_count = 0;
-                        log_ptr->type.output.store_count = 0;
-                        store_data = true;
-                        triggered = true;
-                    }
-                }
-            }
-
-            if(store_data)
-            {
-                if(j == 0)
-                {
-                    log_ptr->type.output.store_count++;
-                    if(log_ptr->type.output.store_count > 1024)
-                    {
-                        log_state = TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY;
-                        break;
-                    }
-                }
-                if(!log_data(log_stream_ptr, log_ptr->type.output.store_count-1))
-                {
-                    //we ran out of space to send the data. So we have to drop this capture entirely
-                    //and send a new set of data.
-                    log_state = TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW;
-                    break;
-                }
-            }
+            error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
+            serial_log_memory_free(&selected_instance->memory, log_stream_data_ptr);
+            return false;
         }
+        log_stream_data_ptr->state = SERIAL_LOG_DATA_NOT_SET;
+        pool_ptr->buffers[pool_ptr->free_count++] = log_stream_data_ptr;
+        pool_ptr->buffer_count++;
+    }
+    return true;
+}
 
-        log_ptr->type.output.trigger_state = log_state;
+void serial_log_set_storage_time(uint16_t storage_time_in_ms)
+{
+    if(storage_time_in_ms == 0)
+    {
+        storage_time_in_ms = 1;
     }
+    selected_instance->storage_time = (storage_time_in_ms < MAX_STORAGE_TIME_IN_MS)?storage_time_in_ms:MAX_STORAGE_TIME_IN_MS;
+}
+
+void serial_log_get_memory_stats(serial_log_memory_stats_t *stats)
+{
+    serial_log_memory_get_stats(&selected_instance->memory, stats);
 }
 
 /*
- * This function is expected to be called once every sampling tick.
+ * mode, store period and fixed buffer size that the creating function uses for the planned log
  */
-void serial_log_sample_data()
+static log_output_mode_t get_plan_mode(const serial_log_plan_t *plan, uint16_t *store_period, uint16_t *samples_per_buffer)
+{
+    *samples_per_buffer = 0;
+    switch(plan->type)
+    {
+    case SERIAL_LOG_PLAN_STATISTICS:
+        *store_period = (plan->rate > 1)?(plan->rate - 1):0;
+        return LOG_OUTPUT_STATISTICS;
+    case SERIAL_LOG_PLAN_SPECTRUM:
+        *store_period = get_capture_sample_index(plan->sampling_rate_in_hz, plan->rate);
+        *samples_per_buffer = serial_log_spectrum_size(plan->fft_size)/2 + 4;
+        return LOG_OUTPUT_SPECTRUM;
+    case SERIAL_LOG_PLAN_EVENTS:
+        *store_period = (plan->rate != 0)?plan->rate:0xFFFF;
+        return LOG_OUTPUT_EVENT;
+    case SERIAL_LOG_PLAN_BURST:
+        *store_period = 1;
+        *samples_per_buffer = plan->rate;
+        return LOG_OUTPUT_BURST;
+    default:
+        *store_period = get_capture_sample_index(plan->sampling_rate_in_hz, plan->rate);
+        return LOG_OUTPUT_CAPTURE;
+    }
+}
+
+uint32_t serial_log_plan_samples_per_buffer(const serial_log_plan_t *plan, uint16_t storage_time_in_ms)
 {
-    log_all_output_data();
+    uint16_t store_period, samples_per_buffer;
+    log_output_mode_t mode = get_plan_mode(plan, &store_period, &samples_per_buffer);
+    return get_samples_per_buffer(mode, plan->sampling_rate_in_hz, store_period, samples_per_buffer, storage_time_in_ms);
 }
 
 /*
- * This function is expected to be called in the main loop
+ * adds an allocation of length int units to a category of the plan
  */
-void serial_log_handler(uint32_t in_current_ms)
+static void plan_allocation(serial_log_memory_plan_t *plan_ptr, uint32_t *category_ptr, uint32_t length)
 {
-    serial_log_stream_handler(in_current_ms);
+    uint32_t block_length = serial_log_memory_block_length(length);
+    *category_ptr += length*sizeof(int);
+    plan_ptr->headers += (block_length - length)*sizeof(int);
+    plan_ptr->size += block_length*sizeof(int);
 }
 
-
-#if 0
 /*
- * array of data to be stored, one for each stream
+ * adds every allocation that the creating function makes for the planned log
  */
-bool serial_log_data(void *log_input_ptr,...)
+static void plan_log(serial_log_memory_plan_t *plan_ptr, const serial_log_plan_t *plan, uint16_t storage_time_in_ms)
 {
-    int i;
-    va_list stream_data_list;
-    bool ret = true;
-    log_t *log_ptr = (log_t *)log_input_ptr;
-    if(log_ptr == NULL)
+    int i, j;
+    uint16_t store_period, samples_per_buffer;
+    log_output_mode_t mode = get_plan_mode(plan, &store_period, &samples_per_buffer);
+    //only the logs created from a stream table or a field table can be wide
+    int max_stream_count = (plan->type == SERIAL_LOG_PLAN_CAPTURE || plan->type == SERIAL_LOG_PLAN_EVENTS)?
+                           MAX_LOG_STREAM_COUNT:MAX_LOG_ARG_STREAM_COUNT;
+    int stream_count = (plan->stream_count < max_stream_count)?plan->stream_count:max_stream_count;
+    uint32_t buffer_samples = get_samples_per_buffer(mode, plan->sampling_rate_in_hz, store_period, samples_per_buffer, storage_time_in_ms);
+    int reserved_count = get_reserved_buffers(plan->reserved_buffers);
+    bool has_sample_stream = false;
+
+    if(plan->struct_size != 0)
     {
-        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
-        //we don't have space for new stream
-        return false;
+        //copy of the struct followed by the converted values
+        uint32_t struct_size = (plan->struct_size + sizeof(float) - 1)/sizeof(float)*sizeof(float);
+        plan_allocation(plan_ptr, &plan_ptr->extra, adjust_memory_length(struct_size + stream_count*sizeof(float)));
     }
-    va_start(stream_data_list, log_input_ptr);
-    //for(i = 0; i < log_ptr->type.output.stream_count&&ret; ++i)
-    for(i = 0; i < STREAM_COUNT(log_ptr)&&ret; ++i)
+    if(plan->type == SERIAL_LOG_PLAN_DERIVED)
     {
-        float data;
-        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[i];//log_ptr->type.output.streams[i];
-        data = va_arg(stream_data_list, float);
-        ret = log_data(log_stream_ptr, data);
+        int source_stream_count = (plan->source_stream_count != 0)?plan->source_stream_count:MAX_LOG_ARG_STREAM_COUNT;
+        plan_allocation(plan_ptr, &plan_ptr->extra, adjust_memory_length((stream_count + source_stream_count)*sizeof(float)));
+    }
+    plan_allocation(plan_ptr, &plan_ptr->logs, adjust_memory_length(sizeof(log_t)));
+    plan_allocation(plan_ptr, &plan_ptr->logs, adjust_memory_length(stream_count*sizeof(log_stream_t *)));
+    plan_allocation(plan_ptr, &plan_ptr->logs, get_string_memory_length((plan->title != NULL)?strlen(plan->title):(MAX_NAME_SIZE-1)));
+    for(i = 0; i < stream_count; ++i)
+    {
+        const serial_log_stream_t *stream_ptr = (plan->streams != NULL)?&plan->streams[i]:NULL;
+        log_stream_mode_t stream_mode = get_stream_mode(mode, (stream_ptr != NULL)?stream_ptr->mode:SERIAL_LOG_STREAM_SAMPLE);
+        uint32_t max_bit_count = (uint32_t)get_type_length_in_bits(stream_mode)*buffer_samples;
+        has_sample_stream |= (stream_mode == SERIAL_LOG_STREAM_SAMPLE);
+
+        plan_allocation(plan_ptr, &plan_ptr->streams, adjust_memory_length(sizeof(log_stream_t)));
+        plan_allocation(plan_ptr, &plan_ptr->streams, get_string_memory_length((stream_ptr != NULL)?strlen(stream_ptr->name):(MAX_NAME_SIZE-1)));
+        for(j = 0; j < reserved_count; ++j)
+        {
+            plan_allocation(plan_ptr, &plan_ptr->streams, adjust_memory_length(sizeof(log_stream_data_t)));
+        }
+        for(j = 0; j < reserved_count; ++j)
+        {
+            plan_allocation(plan_ptr, &plan_ptr->data, adjust_memory_length(SERIAL_LOG_BITS_TO_BYTES(max_bit_count)));
+        }
+    }
+    if(plan->compressed && mode == LOG_OUTPUT_CAPTURE && has_sample_stream)
+    {
+        //output buffer of serial_log_set_compression
+        plan_allocation(plan_ptr, &plan_ptr->extra, adjust_memory_length(SERIAL_LOG_COMPRESS_BUFFER_WORDS(buffer_samples)*sizeof(uint32_t)));
+    }
+    if(mode == LOG_OUTPUT_SPECTRUM)
+    {
+        //twiddle table and the samples of every stream
+        uint32_t length = adjust_memory_length(serial_log_spectrum_size(plan->fft_size)*sizeof(float));
+        for(i = 0; i <= stream_count; ++i)
+        {
+            plan_allocation(plan_ptr, &plan_ptr->extra, length);
+        }
     }
-    va_end(stream_data_list);
-    return ret;
 }
-#endif
 
-/*
- * This is the total memory available for logging data
- */
-void serial_log_init(void *buffer, uint32_t buffer_size, uint16_t sampling_rate_in_hz)
+uint32_t serial_log_plan_buffer_pool(uint16_t buffer_count, uint32_t buffer_size)
 {
+    serial_log_memory_plan_t plan;
     int i;
-    memory_buffer = buffer;
-    memory_buffer_size = buffer_size;
-    memory_buffer_position = 0;
-    sampling_rate = sampling_rate_in_hz;
-    //timer_ticks = (1000 + sampling_rate/2)/sampling_rate;
-    for(i = 0; i < MAX_LOGS; ++i)
+    memset(&plan, 0, sizeof(plan));
+    for(i = 0; i < buffer_count; ++i)
     {
-        logs[i] = NULL;
+        plan_allocation(&plan, &plan.streams, adjust_memory_length(sizeof(log_stream_data_t)));
+        plan_allocation(&plan, &plan.data, adjust_memory_length(buffer_size));
     }
-    serial_log_stream_handler_init();
-    serial_log_uart_init();
+    return plan.size;
 }
 
-
-void *serial_log_output(const char * title, uint16_t bandwidth_in_hz, int stream_count,...)
+uint32_t serial_log_plan_memory(const serial_log_plan_t *plans, int plan_count, uint16_t storage_time_in_ms, serial_log_memory_plan_t *breakdown)
 {
-    int i, j, length,memory_size_per_buffer;
-    log_t *log_ptr;
-    va_list stream_list;
+    int i;
+    serial_log_memory_plan_t plan;
+    memset(&plan, 0, sizeof(plan));
+    for(i = 0; i < plan_count; ++i)
+    {
+        plan_log(&plan, &plans[i], storage_time_in_ms);
+    }
+    if(breakdown != NULL)
+    {
+        *breakdown = plan;
+    }
+    return plan.size;
+}
 
-    log_ptr = allocate_log_ptr((char *)title);
-    if(log_ptr == NULL)
+uint16_t serial_log_plan_storage_time(const serial_log_plan_t *plans, int plan_count, uint32_t log_memory_size)
+{
+    uint16_t low = 0, high = MAX_STORAGE_TIME_IN_MS;
+    //serial_log_init only uses whole pointers of the memory
+    uint32_t available = log_memory_size/sizeof(void *)*sizeof(void *);
+    //the memory only grows with the storage time
+    while(low < high)
     {
-        //we ran out of memory
-        error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
-        return NULL;
+        uint16_t middle = high - (high - low)/2;
+        if(serial_log_plan_memory(plans, plan_count, middle, NULL) <= available)
+            low = middle;
+        else
+            high = middle - 1;
     }
+    return low;
+}
 
-    //assign all the streams as NULL
-    for(i = 0; i < MAX_LOG_STREAM_COUNT; ++i)
+void serial_log_set_filter(void *log_output_ptr, log_filter_t filter)
+{
+    int j;
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    log_output_t *output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT)
     {
-        STREAMS(log_ptr)[i] = NULL;
+        return;
     }
-    log_ptr->direction = LOG_OUTPUT;
-    stream_count = STREAM_COUNT(log_ptr) = (stream_count < MAX_LOG_STREAM_COUNT)?stream_count:MAX_LOG_STREAM_COUNT;
-    //stream_count = STREAM_COUNT(log_ptr);
+    output_ptr = &log_ptr->type.output;
+    if(output_ptr->mode != LOG_OUTPUT_CAPTURE && output_ptr->mode != LOG_OUTPUT_SPECTRUM)
+    {
+        return;
+    }
+    //the new filter starts settled at the current filtered value of every stream
+    for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+    {
+        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];
+        float value = log_stream_ptr->data_value;
+        int32_t fixed_value = get_fixed_value(value);
+        log_stream_ptr->sum = 0;
+        log_stream_ptr->window_count = 0;
+        if(filter == SERIAL_LOG_FILTER_BUTTERWORTH_FIXED)
+        {
+            log_stream_ptr->filter_state.q[0] = log_stream_ptr->filter_state.q[1] = fixed_value;
+            log_stream_ptr->filter_state.q[2] = log_stream_ptr->filter_state.q[3] = fixed_value;
+        }
+        else
+        {
+            log_stream_ptr->filter_state.z[0] = value*(1.0f - output_ptr->biquad[0]);
+            log_stream_ptr->filter_state.z[1] = value*(output_ptr->biquad[2] - output_ptr->biquad[4]);
+        }
+    }
+    output_ptr->filter = filter;
+}
 
-    va_start( stream_list, stream_count );
-    for(i = 0; i < stream_count; ++i)
+/*
+ * compresses the buffers of the sample streams of a capture log in the main loop. The output
+ * buffer is taken from the memory of the log when compression is first enabled
+ */
+void serial_log_set_compression(void *log_output_ptr, bool enabled)
+{
+    int j;
+    uint32_t sample_count = 0;
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.mode != LOG_OUTPUT_CAPTURE || log_ptr->static_log)
     {
-        const char *stream_name = va_arg( stream_list, const char *);
-        float *data_ptr = va_arg( stream_list, float *);
-        STREAMS(log_ptr)[i] = allocate_new_log_stream(stream_name, data_ptr, stream_count);
-        if(STREAMS(log_ptr)[i] == NULL)
+        return;
+    }
+    if(enabled && log_ptr->type.output.compress_ptr == NULL)
+    {
+        for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
+        {
+            if(STREAMS(log_ptr)[j]->mode == SERIAL_LOG_STREAM_SAMPLE)
+                sample_count = STREAMS(log_ptr)[j]->max_bit_count/STREAMS(log_ptr)[j]->type_length_in_bits;
+        }
+        if(sample_count == 0)
+        {
+            return;
+        }
+        log_ptr->type.output.compress_ptr = (uint32_t *)serial_log_memory_allocate(&log_ptr->instance->memory,
+                                            adjust_memory_length(SERIAL_LOG_COMPRESS_BUFFER_WORDS(sample_count)*sizeof(uint32_t)));
+        if(log_ptr->type.output.compress_ptr == NULL)
         {
-            //we ran out of memory
             error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
-            return NULL;
+            return;
         }
-        //STREAMS(log_ptr)[i] = log_stream_ptr;
     }
-    va_end(stream_list);
+    log_ptr->type.output.compress = enabled;
+}
 
-    log_ptr->type.output.lpf = (float)bandwidth_in_hz/(2*3.14*sampling_rate);
-    log_ptr->type.output.sample_count = 0;
-    //output should be sampled atleast twice the bandwidth
-    log_ptr->type.output.sample_index = (sampling_rate + 2*bandwidth_in_hz - 1)/(2*bandwidth_in_hz);
-    //Now allocate space for storing the data. We will allocate enough space to
-    //store data for 100ms. So at 1000Hz sampling rate that will be 100 float units of space
-    uint32_t buffer_size = ((uint32_t)sampling_rate*STORAGE_TIME_IN_MS + (uint32_t)log_ptr->type.output.sample_index*1000 - 1)/ ((uint32_t)log_ptr->type.output.sample_index*1000); //(bandwidth_in_hz + STORAGE_TIME_IN_MS - 1)/STORAGE_TIME_IN_MS;
-    //buffer size has to be divided among the MAX_STREAM_DATA_BUFFERS
-    memory_size_per_buffer = ((buffer_size + MAX_STREAM_DATA_BUFFERS - 1)/MAX_STREAM_DATA_BUFFERS);
-    //memory_size_per_buffer&=(~(uint32_t)(sizeof(uint32_t)-1)); //make sure that the buffer_size is divisible by uint32_t data type
+/*
+ * sets the number of low frequency bins of a spectrum log that are sent to the host
+ */
+void serial_log_set_spectrum_bins(void *log_output_ptr, uint16_t bin_count)
+{
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.mode != LOG_OUTPUT_SPECTRUM)
+    {
+        return;
+    }
+    if(bin_count == 0 || bin_count > log_ptr->type.output.fft_size/2)
+    {
+        bin_count = log_ptr->type.output.fft_size/2;
+    }
+    log_ptr->type.output.bin_count = bin_count;
+}
 
-    for(i = 0; i < STREAM_COUNT(log_ptr); ++i)
+uint16_t serial_log_get_dropped_spectra(void *log_output_ptr)
+{
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || log_ptr->type.output.mode != LOG_OUTPUT_SPECTRUM)
     {
-        log_stream_t *log_stream_ptr = STREAMS(log_ptr)[i];
-        log_stream_ptr->max_bit_count = log_stream_ptr->type_length_in_bits*memory_size_per_buffer;//SERIAL_LOG_BYTES_TO_BITS(memory_size_per_buffer); //number of bits that we can store
-        for(j = 0; j < MAX_STREAM_DATA_BUFFERS; ++j)
-        {
-            int *memory;
-            log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[j];
-            length = SERIAL_LOG_BITS_TO_BYTES(log_stream_ptr->max_bit_count);
-            length = adjust_memory_length(length);
-            memory = allocate_memory(length);
-            if(memory == NULL)
-            {
-                error_code = STREAM_LOG_ERR_OUT_OF_MEMORY;
-                return NULL;
-            }
-            log_stream_data_ptr->data_ptr = (uint32_t *)memory;
-        }
+        return 0;
     }
+    return log_ptr->type.output.dropped_spectra;
+}
 
-    return log_ptr;
+/*
+ * changes the trigger of an output log. The trigger is only staged here and the sampling
+ * side applies it on its next tick, so a capture in progress is completed before the new
+ * trigger is used
+ */
+void serial_log_set_trigger(void *log_output_ptr, const serial_log_trigger_t *trigger)
+{
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT || trigger == NULL)
+    {
+        return;
+    }
+    //the count stays odd while the pending trigger is written so that a sampling tick
+    //in between does not apply half of it
+    log_ptr->type.output.trigger_set_count++;
+    log_ptr->type.output.pending_trigger = *trigger;
+    log_ptr->type.output.trigger_set_count++;
+}
+
+/*
+ * adds an output log to the trigger group led by master. The member stops using its
+ * own trigger and starts every capture on the same tick as the master
+ */
+bool serial_log_join_trigger_group(void *master_log_ptr, void *member_log_ptr)
+{
+    log_t *master_ptr = (log_t *)master_log_ptr;
+    log_t *member_ptr = (log_t *)member_log_ptr;
+    if(master_ptr == NULL || member_ptr == NULL || master_ptr == member_ptr)
+    {
+        return false;
+    }
+    if(master_ptr->direction != LOG_OUTPUT || member_ptr->direction != LOG_OUTPUT)
+    {
+        return false;
+    }
+    //the whole group has to be sampled from the same interrupt
+    if(master_ptr->instance != member_ptr->instance || master_ptr->type.output.sample_group != member_ptr->type.output.sample_group)
+    {
+        return false;
+    }
+    //groups cannot be nested and a log can only be in one group
+    if(master_ptr->type.output.group_master != NULL || member_ptr->type.output.group_master != NULL ||
+       member_ptr->type.output.group_next != NULL)
+    {
+        return false;
+    }
+    member_ptr->type.output.group_next = master_ptr->type.output.group_next;
+    member_ptr->type.output.group_master = master_ptr;
+    master_ptr->type.output.group_next = member_ptr;
+    return true;
+}
+
+/*
+ * fires the trigger of an output log on the first tick it is able to start a capture,
+ * whether or not the source has armed it. A capture in progress is completed first
+ */
+void serial_log_force_trigger(void *log_output_ptr)
+{
+    log_t *log_ptr = (log_t *)log_output_ptr;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT)
+    {
+        return;
+    }
+    log_ptr->type.output.trigger.force = true;
 }
 
 void *serial_log_input(const char * title, int init_value, log_input_handler_t handler_func)
@@ -672,6 +2874,10 @@ void *serial_log_input(const char * title, int init_value, log_input_handler_t h
     log_ptr->direction = LOG_INPUT;
     log_ptr->type.input.value = init_value;
     log_ptr->type.input.func = handler_func;
+    if(publish_log(log_ptr) == NULL)
+    {
+        return NULL;
+    }
 
     if(handler_func != NULL)
         handler_func(init_value); //call the handler function with the init value
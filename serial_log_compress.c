@@ -1,158 +1,140 @@
-#ifdef COMPRESS_STREAM
+/*
+ * serial_log_compress.c
+ *
+ *      Author: RanaBasheer
+ */
 #include "serial_log_compress.h"
 
-static void init_stream_compression_state(log_stream_t *log_stream_ptr)
-{
-    log_stream_ptr->compress.last_log_data = 0;
-    log_stream_ptr->compress.last_meaningful_bit_count = \
-    log_stream_ptr->compress.last_leading_zero_count = \
-    log_stream_ptr->compress.last_trailing_zero_count = 32;
-}
-
 /*
- * fill the data into the log stream buffer one by one
+ * A compressed buffer starts with the 32 bits of its first value. Every following value
+ * is xored with the previous one and stored as
+ *   0                       the value did not change
+ *   1 0 bits                the changed bits fit in the window of the previous value
+ *   1 1 lead(5) len(6) bits the changed bits open a new window of len bits after lead zeros
+ * Bits are packed from the lsb of every 32 bit word like the plain buffers.
  */
 
-static bool pack_stream_data(log_stream_t *log_stream_ptr, float data)
+typedef struct log_stream_compress_t
 {
-    #define TOTAL_BIT_COUNT (sizeof(uint32_t)<<3)
+    uint32_t last_log_data;
+    uint8_t last_leading_zero_count;
+    uint8_t last_trailing_zero_count;
+    uint8_t last_meaningful_bit_count;
+} log_stream_compress_t;
 
-    int i;
-    uint32_t int_data;
-    uint32_t value;
-    uint32_t xor_data;
-    uint8_t trailing_zero_count;      //number of zeros preceding the first value bit
-    uint8_t meaningful_bit_count;     //number of bits used for the value
-    uint8_t leading_zero_count;       //number of zeros after the last value bit
-    uint8_t last_value_bit_position;  //position of the last_value_bit
+/*
+ * appends the bits of value at the end of the buffer. The buffer is written sequentially
+ * so a word is cleared when the first bit is written into it
+ */
+static void append_bits(uint32_t *data_ptr, uint32_t bit_offset, uint32_t value, uint8_t bit_count)
+{
+    uint32_t index = bit_offset >> 5;
+    uint8_t shift = bit_offset & 0x1F;
+    if(shift == 0)
+        data_ptr[index] = 0;
+    data_ptr[index] |= value << shift;
+    if(shift + bit_count > 32)
+        data_ptr[index + 1] = value >> (32 - shift);
+}
 
-    if(log_stream_ptr == NULL)
-    {
-        //we don't have space for new stream
-        return false;
-    }
+static uint8_t count_leading_zeros(uint32_t value)
+{
+    uint8_t count = 0;
+    if((value & 0xFFFF0000) == 0) { count += 16; value <<= 16; }
+    if((value & 0xFF000000) == 0) { count += 8; value <<= 8; }
+    if((value & 0xF0000000) == 0) { count += 4; value <<= 4; }
+    if((value & 0xC0000000) == 0) { count += 2; value <<= 2; }
+    if((value & 0x80000000) == 0) { count += 1; }
+    return count;
+}
 
-    if(log_stream_ptr->active_stream_data_ptr == NULL)
-    {
-        //we don't have an active data buffer. Try to see if one freed up because the serial
-        //code had sent it out
-        log_stream_ptr->active_stream_data_ptr = find_free_stream_data_buffer(log_stream_ptr);
-        if(log_stream_ptr->active_stream_data_ptr == NULL)
-        {
-            //no free data buffer is yet available
-            return false;
-        }
-        init_active_stream_data_buffer(log_stream_ptr);
-    }
+static uint8_t count_trailing_zeros(uint32_t value)
+{
+    uint8_t count = 0;
+    if((value & 0x0000FFFF) == 0) { count += 16; value >>= 16; }
+    if((value & 0x000000FF) == 0) { count += 8; value >>= 8; }
+    if((value & 0x0000000F) == 0) { count += 4; value >>= 4; }
+    if((value & 0x00000003) == 0) { count += 2; value >>= 2; }
+    if((value & 0x00000001) == 0) { count += 1; }
+    return count;
+}
 
-    //if we don't have space to add another 32 more bits of data then this buffer is
-    //ready to go out. assign the active buffer as the next free one
-    if(log_stream_ptr->active_stream_data_ptr->data_bits+32 >= log_stream_ptr->max_bit_count)
-    {
-        //set_active_stream_data_inactive(log_stream_ptr);
-        log_stream_ptr->active_stream_data_ptr = find_free_stream_data_buffer(log_stream_ptr);
-        if(log_stream_ptr->active_stream_data_ptr == NULL)
-        {
-            printf("out of space\n");
-            //we have no active space available. so return false
-            return false;
-        }
-        //we have a new active stream data ptr so reset all the last data metric
-        init_active_stream_data_buffer(log_stream_ptr);
-    }
+/*
+ * resets the state at the start of a compressed buffer so that no window is reused
+ */
+static void init_compress_state(log_stream_compress_t *compress_ptr)
+{
+    compress_ptr->last_log_data = 0;
+    compress_ptr->last_meaningful_bit_count = 0;
+    compress_ptr->last_leading_zero_count = 32;
+    compress_ptr->last_trailing_zero_count = 32;
+}
 
+/*
+ * appends the 32 bit value to the compressed buffer and returns the new bit count of the
+ * buffer. At most 45 bits are written
+ */
+static uint32_t compress_sample(log_stream_compress_t *compress_ptr, uint32_t *data_ptr, uint32_t bit_offset, uint32_t value)
+{
+    uint32_t xor_data;
+    uint8_t leading_zero_count, trailing_zero_count;
 
-    int_data = *((uint32_t *)&data);
-    
-    if(log_stream_ptr->active_stream_data_ptr->data_bits == 0)
+    if(bit_offset == 0)
     {
-      log_stream_ptr->compress.last_log_data = int_data;
-      memcpy(log_stream_ptr->active_stream_data_ptr->data_ptr, &int_data, sizeof(uint32_t));
-      log_stream_ptr->active_stream_data_ptr->data_bits += 32;
-      return (log_stream_ptr->active_stream_data_ptr->data_bits<log_stream_ptr->max_bit_count);
+        compress_ptr->last_log_data = value;
+        append_bits(data_ptr, 0, value, 32);
+        return 32;
     }
-    
-    //xor the new int data with the previous one and store the result in int_data
-    xor_data = log_stream_ptr->compress.last_log_data ^ int_data;
-    //printf("last input: %08X %08X %08X\n", log_stream_ptr->last_log_data, int_data, xor_data);
 
+    xor_data = compress_ptr->last_log_data ^ value;
     if(xor_data == 0)
     {
-        //new data and the last data are same since the XOR resulted in zero.
-        //so store the control bit of zero
-        log_stream_ptr->active_stream_data_ptr->data_bits++;
-        return (log_stream_ptr->active_stream_data_ptr->data_bits<log_stream_ptr->max_bit_count);
+        append_bits(data_ptr, bit_offset, 0, 1);
+        return bit_offset + 1;
     }
+    compress_ptr->last_log_data = value;
 
-    log_stream_ptr->compress.last_log_data = int_data;
-    
-    int_data = xor_data;
-    
-    trailing_zero_count = 0;
-    last_value_bit_position = 0;
-    value = 0;
-    /*
-     * scan through the data bit value and find the trailing zero count
-     * and the last value bit position
-     */
-    for(i = 0; i < TOTAL_BIT_COUNT; ++i)
+    leading_zero_count = count_leading_zeros(xor_data);
+    trailing_zero_count = count_trailing_zeros(xor_data);
+    if(leading_zero_count >= compress_ptr->last_leading_zero_count &&
+       trailing_zero_count >= compress_ptr->last_trailing_zero_count)
     {
-        if(xor_data & 0x1)
-        {
-            if(value == 0)
-            {
-                //this is where the value data bit starts
-                trailing_zero_count = i;
-                value = xor_data;
-            }
-            last_value_bit_position = i+1;
-        }
-
-        xor_data >>= 1;
+        //control bits 1 0 and the bits of the previous window
+        append_bits(data_ptr, bit_offset, 0x1, 2);
+        bit_offset += 2;
     }
-    leading_zero_count = TOTAL_BIT_COUNT - last_value_bit_position;
-    meaningful_bit_count = last_value_bit_position - trailing_zero_count;
-    //printf("1");
-    store_data_bits(0x1, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, 1);
-    log_stream_ptr->active_stream_data_ptr->data_bits+=1;
-    if((log_stream_ptr->compress.last_leading_zero_count <= leading_zero_count) && \
-            (log_stream_ptr->compress.last_trailing_zero_count <= trailing_zero_count)
-            )
+    else
     {
-        //this new value falls within the meaningful bit count of last value
-        //store the control bit zero;
-        log_stream_ptr->active_stream_data_ptr->data_bits++;
-        meaningful_bit_count = log_stream_ptr->compress.last_meaningful_bit_count;
-        trailing_zero_count = log_stream_ptr->compress.last_trailing_zero_count;
-        leading_zero_count = log_stream_ptr->compress.last_leading_zero_count;
+        compress_ptr->last_leading_zero_count = leading_zero_count;
+        compress_ptr->last_trailing_zero_count = trailing_zero_count;
+        compress_ptr->last_meaningful_bit_count = 32 - leading_zero_count - trailing_zero_count;
+        //control bits 1 1 followed by the new window. A length of 32 still fits in 6 bits
+        append_bits(data_ptr, bit_offset, 0x3 | ((uint32_t)leading_zero_count << 2) |
+                    ((uint32_t)compress_ptr->last_meaningful_bit_count << 7), 13);
+        bit_offset += 13;
     }
-    else
+    append_bits(data_ptr, bit_offset, xor_data >> compress_ptr->last_trailing_zero_count,
+                compress_ptr->last_meaningful_bit_count);
+    return bit_offset + compress_ptr->last_meaningful_bit_count;
+}
+
+/*
+ * compresses the 32 bit samples into data_ptr, which holds SERIAL_LOG_COMPRESS_BUFFER_WORDS of
+ * sample_count. Returns the number of bits, or 0 if the samples do not get any smaller
+ */
+uint32_t serial_log_compress_buffer(const uint32_t *samples_ptr, uint32_t sample_count, uint32_t *data_ptr)
+{
+    log_stream_compress_t compress;
+    uint32_t bit_count = 0;
+    uint32_t i;
+    init_compress_state(&compress);
+    for(i = 0; i < sample_count; ++i)
     {
-        //printf("storing 11 bits\n");
-        log_stream_ptr->compress.last_meaningful_bit_count = meaningful_bit_count;
-        log_stream_ptr->compress.last_leading_zero_count = leading_zero_count;
-        log_stream_ptr->compress.last_trailing_zero_count = trailing_zero_count;
-        //store the control bit 1 followed by the number of leading zeros in 5 bits
-        store_data_bits(0x1, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, 1);
-        log_stream_ptr->active_stream_data_ptr->data_bits+=1;
-        store_data_bits(leading_zero_count, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, 5);
-        log_stream_ptr->active_stream_data_ptr->data_bits += 5;
-        //length of the meaningful bits in the next 6 bits
-        if(meaningful_bit_count > 31 || meaningful_bit_count == 0)
+        bit_count = compress_sample(&compress, data_ptr, bit_count, samples_ptr[i]);
+        if(bit_count >= sample_count*32)
         {
-          printf("outside bound %d %d %d %d\n",log_stream_ptr->active_stream_data_ptr->data_bits>>5, leading_zero_count, meaningful_bit_count, trailing_zero_count);
+            return 0;
         }
-        store_data_bits(meaningful_bit_count, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, 5);
-        log_stream_ptr->active_stream_data_ptr->data_bits += 5;
     }
-    int_data>>=trailing_zero_count;
-    //printf("input: %08X %08X %d %d %d\n", int_data, value, leading_zero_count, meaningful_bit_count, trailing_zero_count);
-    store_data_bits(int_data, log_stream_ptr->active_stream_data_ptr->data_ptr, log_stream_ptr->active_stream_data_ptr->data_bits, meaningful_bit_count);
-    log_stream_ptr->active_stream_data_ptr->data_bits+=meaningful_bit_count;
-    
-    //printf("dataptr: %08X\n", log_stream_ptr->active_stream_data_ptr->data_ptr[0]);
-
-
-    return (log_stream_ptr->active_stream_data_ptr->data_bits<log_stream_ptr->max_bit_count);
+    return bit_count;
 }
-#endif
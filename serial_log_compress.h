@@ -1,5 +1,16 @@
+/*
+ * serial_log_compress.h
+ *
+ *      Author: RanaBasheer
+ */
+
 #ifndef SERIAL_LOG_COMPRESS_H_
 #define SERIAL_LOG_COMPRESS_H_
+#include <stdint.h>
+
+//words of the output buffer for sample_count samples. The last sample can end up to 45 bits past the input size
+#define SERIAL_LOG_COMPRESS_BUFFER_WORDS(sample_count) ((uint32_t)(sample_count) + 2)
 
+uint32_t serial_log_compress_buffer(const uint32_t *samples_ptr, uint32_t sample_count, uint32_t *data_ptr);
 
-#endif //
+#endif /* SERIAL_LOG_COMPRESS_H_ */
@@ -0,0 +1,132 @@
+/*
+ * serial_log_memory.c
+ *
+ *      Author: RanaBasheer
+ */
+#include <stddef.h>
+#include <serial_log.h>
+#include "serial_log_memory.h"
+
+/*
+ * every block of the arena starts with this header. Free blocks are kept in
+ * address order so that a freed block can be merged with its neighbours
+ */
+typedef struct memory_block_t
+{
+    uint32_t length;                //length of the block in int units including the header
+    struct memory_block_t *next;    //next free block. Only used while the block is free
+} memory_block_t;
+
+#define POINTER_LENGTH          (sizeof(void *)/sizeof(int))
+#define BLOCK_HEADER_LENGTH     ((sizeof(memory_block_t) + sizeof(void *) - 1)/sizeof(void *)*POINTER_LENGTH)
+#define MIN_BLOCK_LENGTH        (BLOCK_HEADER_LENGTH + POINTER_LENGTH) //smaller remainders are not split off
+
+void serial_log_memory_init(serial_log_memory_t *arena_ptr, void *buffer, uint32_t buffer_size)
+{
+    arena_ptr->arena_length = buffer_size/sizeof(int)/POINTER_LENGTH*POINTER_LENGTH;
+    arena_ptr->used_length = 0;
+    arena_ptr->high_water_mark = 0;
+    arena_ptr->free_list = NULL;
+    if(arena_ptr->arena_length >= MIN_BLOCK_LENGTH)
+    {
+        arena_ptr->free_list = (memory_block_t *)buffer;
+        arena_ptr->free_list->length = arena_ptr->arena_length;
+        arena_ptr->free_list->next = NULL;
+    }
+}
+
+uint32_t serial_log_memory_block_length(uint32_t length)
+{
+    return length + BLOCK_HEADER_LENGTH;
+}
+
+/*
+ * takes the first free block that is large enough. Blocks are split so
+ * that the remainder stays in the free list at the same position
+ */
+int *serial_log_memory_allocate(serial_log_memory_t *arena_ptr, uint32_t length)
+{
+    memory_block_t **link_ptr = &arena_ptr->free_list;
+    memory_block_t *block_ptr;
+    length += BLOCK_HEADER_LENGTH;
+    for(block_ptr = arena_ptr->free_list; block_ptr != NULL; link_ptr = &block_ptr->next, block_ptr = block_ptr->next)
+    {
+        if(block_ptr->length < length)
+            continue;
+        if(block_ptr->length - length >= MIN_BLOCK_LENGTH)
+        {
+            memory_block_t *rest_ptr = (memory_block_t *)((int *)block_ptr + length);
+            rest_ptr->length = block_ptr->length - length;
+            rest_ptr->next = block_ptr->next;
+            block_ptr->length = length;
+            *link_ptr = rest_ptr;
+        }
+        else
+        {
+            *link_ptr = block_ptr->next;
+        }
+        block_ptr->next = NULL;
+        arena_ptr->used_length += block_ptr->length;
+        if(arena_ptr->used_length > arena_ptr->high_water_mark)
+            arena_ptr->high_water_mark = arena_ptr->used_length;
+        return (int *)block_ptr + BLOCK_HEADER_LENGTH;
+    }
+    return NULL;
+}
+
+/*
+ * puts the block back into the free list and merges it with the free
+ * blocks right before and after it
+ */
+void serial_log_memory_free(serial_log_memory_t *arena_ptr, void *memory)
+{
+    memory_block_t *block_ptr, *prev_ptr = NULL, *next_ptr = arena_ptr->free_list;
+    if(memory == NULL)
+    {
+        return;
+    }
+    block_ptr = (memory_block_t *)((int *)memory - BLOCK_HEADER_LENGTH);
+    arena_ptr->used_length -= block_ptr->length;
+    while(next_ptr != NULL && next_ptr < block_ptr)
+    {
+        prev_ptr = next_ptr;
+        next_ptr = next_ptr->next;
+    }
+
+    block_ptr->next = next_ptr;
+    if(next_ptr != NULL && (int *)block_ptr + block_ptr->length == (int *)next_ptr)
+    {
+        block_ptr->length += next_ptr->length;
+        block_ptr->next = next_ptr->next;
+    }
+    if(prev_ptr == NULL)
+    {
+        arena_ptr->free_list = block_ptr;
+    }
+    else if((int *)prev_ptr + prev_ptr->length == (int *)block_ptr)
+    {
+        prev_ptr->length += block_ptr->length;
+        prev_ptr->next = block_ptr->next;
+    }
+    else
+    {
+        prev_ptr->next = block_ptr;
+    }
+}
+
+void serial_log_memory_get_stats(serial_log_memory_t *arena_ptr, serial_log_memory_stats_t *stats)
+{
+    memory_block_t *block_ptr;
+    stats->size = arena_ptr->arena_length*sizeof(int);
+    stats->used = arena_ptr->used_length*sizeof(int);
+    stats->high_water_mark = arena_ptr->high_water_mark*sizeof(int);
+    stats->largest_free = 0;
+    stats->free_blocks = 0;
+    for(block_ptr = arena_ptr->free_list; block_ptr != NULL; block_ptr = block_ptr->next)
+    {
+        uint32_t length = (block_ptr->length - BLOCK_HEADER_LENGTH)*sizeof(int);
+        if(length > stats->largest_free)
+            stats->largest_free = length;
+        stats->free_blocks++;
+    }
+}
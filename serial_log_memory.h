@@ -0,0 +1,29 @@
+/*
+ * serial_log_memory.h
+ *
+ *      Author: RanaBasheer
+ */
+
+#ifndef SERIAL_LOG_MEMORY_H_
+#define SERIAL_LOG_MEMORY_H_
+#include <stdint.h>
+#include <serial_log.h>
+
+//arena that the logs of an instance are allocated from
+typedef struct serial_log_memory_t
+{
+    struct memory_block_t *free_list;
+    uint32_t arena_length;
+    uint32_t used_length;
+    uint32_t high_water_mark;
+} serial_log_memory_t;
+
+//lengths are in int units and have to be multiples of sizeof(void *)
+void serial_log_memory_init(serial_log_memory_t *arena_ptr, void *buffer, uint32_t buffer_size);
+int *serial_log_memory_allocate(serial_log_memory_t *arena_ptr, uint32_t length);
+void serial_log_memory_free(serial_log_memory_t *arena_ptr, void *memory);
+void serial_log_memory_get_stats(serial_log_memory_t *arena_ptr, serial_log_memory_stats_t *stats);
+//length of the arena taken up by an allocation of length, including its block header
+uint32_t serial_log_memory_block_length(uint32_t length);
+
+#endif /* SERIAL_LOG_MEMORY_H_ */
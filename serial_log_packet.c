@@ -42,6 +42,38 @@ static uint16_t crc16_get(uint16_t current_crc, uint8_t byte)
     return current_crc;
 }
 
+/*
+ * the link of the packet carries the bytes, or the uart of the platform if it has none
+ */
+static void uart_tx(serial_log_packet_t *packet_ptr, uint8_t data)
+{
+    if(packet_ptr->link != NULL)
+        packet_ptr->link->tx(packet_ptr->link->context, data);
+    else
+        serial_log_uart_tx(data);
+}
+
+static uint8_t uart_rx(serial_log_packet_t *packet_ptr)
+{
+    if(packet_ptr->link != NULL)
+        return packet_ptr->link->rx(packet_ptr->link->context);
+    return serial_log_uart_rx();
+}
+
+static bool is_uart_tx_more(serial_log_packet_t *packet_ptr)
+{
+    if(packet_ptr->link != NULL)
+        return packet_ptr->link->is_tx_more(packet_ptr->link->context);
+    return is_serial_log_uart_tx_more();
+}
+
+static bool is_uart_rx_ready(serial_log_packet_t *packet_ptr)
+{
+    if(packet_ptr->link != NULL)
+        return packet_ptr->link->is_rx_ready(packet_ptr->link->context);
+    return is_serial_log_uart_rx_ready();
+}
+
 static void recv_data_byte(serial_log_packet_t *packet_ptr, uint8_t data)
 {
     //packet_ptr->buffer[packet_ptr->index++] = data;
@@ -57,14 +89,14 @@ static void recv_data_byte(serial_log_packet_t *packet_ptr, uint8_t data)
 static void send_control_byte(serial_log_packet_t *packet_ptr, uint8_t control)
 {
     //send the packet
-    serial_log_uart_tx(control);
+    uart_tx(packet_ptr, control);
     packet_ptr->state.tx = WAIT_FOR_ACK;
 }
 
 static void send_data_byte(serial_log_packet_t *packet_ptr, uint8_t data)
 {
     //send the packet
-    serial_log_uart_tx(data);
+    uart_tx(packet_ptr, data);
     packet_ptr->state.tx = WAIT_FOR_ACK;
     //update CRC
     packet_ptr->crc = crc16_get(packet_ptr->crc, data);
@@ -132,7 +164,7 @@ void serial_log_packet_build_tx(serial_log_packet_t *packet_ptr)
     break;
     
     case WAIT_FOR_ACK:
-    if(is_serial_log_uart_tx_more())
+    if(is_uart_tx_more(packet_ptr))
     {
       packet_ptr->state.tx = packet_ptr->next_tx_state;
     }
@@ -232,9 +264,9 @@ void serial_log_packet_build_tx(serial_log_packet_t *packet_ptr)
 void serial_log_packet_build_rx(serial_log_packet_t *packet_ptr, void (*rx_data_handler)(serial_log_packet_t *))
 {
   uint8_t data;
-  if(is_serial_log_uart_rx_ready())
+  if(is_uart_rx_ready(packet_ptr))
   {
-    data = serial_log_uart_rx();
+    data = uart_rx(packet_ptr);
     //buffer[index++] = data;
     if(packet_ptr->index >= packet_ptr->length)
     {
@@ -54,6 +54,8 @@ typedef struct {
   uint16_t  length;
   uint16_t  index;
   uint16_t  crc;
+  const serial_log_link_t *link; //NULL to use the uart of the platform
+  void      *owner; //layer that the packet belongs to, for the rx handler
 } serial_log_packet_t;
 
 
@@ -0,0 +1,137 @@
+/*
+ * serial_log_spectrum.c
+ *
+ *      Author: RanaBasheer
+ */
+#include <math.h>
+#include "serial_log_spectrum.h"
+
+#define PI 3.14159265358979f
+
+/*
+ * returns the largest power of two that is not bigger than the requested fft size
+ */
+uint16_t serial_log_spectrum_size(uint16_t fft_size)
+{
+    uint16_t size = SERIAL_LOG_MIN_FFT_SIZE;
+    while(size < SERIAL_LOG_MAX_FFT_SIZE && (size << 1) <= fft_size)
+    {
+        size <<= 1;
+    }
+    return size;
+}
+
+/*
+ * fills the table with fft_size/2 complex twiddle factors e^(-j*2*pi*k/fft_size)
+ * stored as interleaved real and imaginary values
+ */
+void serial_log_spectrum_init_twiddles(float *twiddle_ptr, uint16_t fft_size)
+{
+    uint16_t k;
+    for(k = 0; k < fft_size/2; ++k)
+    {
+        float angle = 2*PI*k/fft_size;
+        twiddle_ptr[2*k] = cosf(angle);
+        twiddle_ptr[2*k+1] = -sinf(angle);
+    }
+}
+
+/*
+ * in place radix 2 fft of the fft_size/2 complex values formed by the even
+ * samples as real part and odd samples as imaginary part
+ */
+static void complex_fft(float *z_ptr, const float *twiddle_ptr, uint16_t fft_size)
+{
+    uint16_t count = fft_size/2;
+    uint16_t i, j, k, length;
+    float real, imag;
+
+    //bit reverse the order of the values
+    for(i = 1, j = 0; i < count; ++i)
+    {
+        uint16_t bit = count >> 1;
+        for(; j & bit; bit >>= 1)
+        {
+            j ^= bit;
+        }
+        j ^= bit;
+        if(i < j)
+        {
+            real = z_ptr[2*i]; z_ptr[2*i] = z_ptr[2*j]; z_ptr[2*j] = real;
+            imag = z_ptr[2*i+1]; z_ptr[2*i+1] = z_ptr[2*j+1]; z_ptr[2*j+1] = imag;
+        }
+    }
+
+    for(length = 2; length <= count; length <<= 1)
+    {
+        uint16_t half = length >> 1;
+        //twiddles of a count point fft are every other one of the fft_size table
+        uint16_t stride = fft_size/length;
+        for(i = 0; i < count; i += length)
+        {
+            for(k = 0; k < half; ++k)
+            {
+                float *a_ptr = z_ptr + 2*(i + k);
+                float *b_ptr = z_ptr + 2*(i + k + half);
+                float w_real = twiddle_ptr[2*k*stride];
+                float w_imag = twiddle_ptr[2*k*stride+1];
+                real = b_ptr[0]*w_real - b_ptr[1]*w_imag;
+                imag = b_ptr[0]*w_imag + b_ptr[1]*w_real;
+                b_ptr[0] = a_ptr[0] - real;
+                b_ptr[1] = a_ptr[1] - imag;
+                a_ptr[0] += real;
+                a_ptr[1] += imag;
+            }
+        }
+    }
+}
+
+/*
+ * returns the magnitude of bin k of the real fft from the half size complex fft.
+ * z_k is the value at k and z_c is the value at count-k
+ */
+static float split_magnitude(const float *z_k, const float *z_c, const float *w)
+{
+    float even_real = (z_k[0] + z_c[0])*0.5f;
+    float even_imag = (z_k[1] - z_c[1])*0.5f;
+    float odd_real = (z_k[1] + z_c[1])*0.5f;
+    float odd_imag = (z_c[0] - z_k[0])*0.5f;
+    float real = even_real + w[0]*odd_real - w[1]*odd_imag;
+    float imag = even_imag + w[0]*odd_imag + w[1]*odd_real;
+    return sqrtf(real*real + imag*imag);
+}
+
+/*
+ * replaces the fft_size real samples with the amplitudes of the first fft_size/2
+ * frequency bins. The twiddle table has to be made for the same fft_size
+ */
+void serial_log_spectrum_magnitude(float *samples_ptr, const float *twiddle_ptr, uint16_t fft_size)
+{
+    uint16_t count = fft_size/2;
+    uint16_t k;
+    float scale = 2.0f/fft_size;
+    float dc;
+
+    complex_fft(samples_ptr, twiddle_ptr, fft_size);
+
+    //dc only uses the first value
+    dc = (samples_ptr[0] + samples_ptr[1])*0.5f*scale;
+    samples_ptr[0] = (dc < 0)?-dc:dc;
+    for(k = 1; k <= count/2; ++k)
+    {
+        float *z_k = samples_ptr + 2*k;
+        float *z_c = samples_ptr + 2*(count - k);
+        float magnitude = split_magnitude(z_k, z_c, twiddle_ptr + 2*k)*scale;
+        if(k != count - k)
+        {
+            float magnitude_c = split_magnitude(z_c, z_k, twiddle_ptr + 2*(count - k))*scale;
+            z_c[0] = magnitude_c;
+        }
+        z_k[0] = magnitude;
+    }
+    //the magnitudes were left in the real part of their slot. Pack them together
+    for(k = 1; k < count; ++k)
+    {
+        samples_ptr[k] = samples_ptr[2*k];
+    }
+}
@@ -0,0 +1,18 @@
+/*
+ * serial_log_spectrum.h
+ *
+ *      Author: RanaBasheer
+ */
+
+#ifndef SERIAL_LOG_SPECTRUM_H_
+#define SERIAL_LOG_SPECTRUM_H_
+#include <stdint.h>
+
+#define SERIAL_LOG_MIN_FFT_SIZE   8
+#define SERIAL_LOG_MAX_FFT_SIZE   1024 //a capture cannot store more samples than this
+
+uint16_t serial_log_spectrum_size(uint16_t fft_size);
+void serial_log_spectrum_init_twiddles(float *twiddle_ptr, uint16_t fft_size);
+void serial_log_spectrum_magnitude(float *samples_ptr, const float *twiddle_ptr, uint16_t fft_size);
+
+#endif /* SERIAL_LOG_SPECTRUM_H_ */
@@ -0,0 +1,112 @@
+/*
+ * serial_log_static.h
+ *
+ *      Author: RanaBasheer
+ */
+
+#ifndef SERIAL_LOG_STATIC_H_
+#define SERIAL_LOG_STATIC_H_
+#include "serial_log_types.h"
+
+/*
+ * Capture log declared at compile time. The title, the stream table and this description are const
+ * so they stay in flash and the log, its streams and its buffers are reserved by the linker.
+ */
+typedef struct serial_log_static_t {
+    const char *title;
+    uint16_t bandwidth_in_hz;
+    int stream_count;
+    const serial_log_stream_t *streams; //name, data pointer and mode of every stream. Modes are limited to 32 bits a sample
+    uint16_t samples_per_buffer;
+    log_t *log_ptr;
+    log_stream_t *log_streams;
+    log_stream_t **stream_ptrs;         //pointer to every stream of log_streams
+    log_stream_data_t *buffers;         //MAX_STREAM_DATA_BUFFERS for every stream
+    uint32_t *data;                     //samples_per_buffer words for every buffer
+    uint8_t sample_group;               //only used by logs registered with SERIAL_LOG_REGISTER
+} serial_log_static_t;
+
+//decimation of a capture log, the same as serial_log_output picks at run time
+#define SERIAL_LOG_STATIC_SAMPLE_INDEX(sampling_rate_in_hz, bandwidth_in_hz) \
+    (((uint32_t)(sampling_rate_in_hz) + 2*(uint32_t)(bandwidth_in_hz) - 1)/(2*(uint32_t)(bandwidth_in_hz)))
+
+//samples in every buffer of a capture log so that the buffers hold STORAGE_TIME_IN_MS of data
+#define SERIAL_LOG_STATIC_SAMPLES(sampling_rate_in_hz, bandwidth_in_hz) \
+    (((((uint32_t)(sampling_rate_in_hz)*STORAGE_TIME_IN_MS + SERIAL_LOG_STATIC_SAMPLE_INDEX(sampling_rate_in_hz, bandwidth_in_hz)*1000 - 1)/ \
+       (SERIAL_LOG_STATIC_SAMPLE_INDEX(sampling_rate_in_hz, bandwidth_in_hz)*1000)) + MAX_STREAM_DATA_BUFFERS - 1)/MAX_STREAM_DATA_BUFFERS)
+
+/*
+ * Declares the storage and the description of a capture log as name. sampling_rate_in_hz is the rate of the
+ * sample group the log is going to be registered in and only sizes the buffers.
+ *
+ * For e.g.
+ * static const serial_log_stream_t coil_streams[] = {
+ *     {"A", &current_a, SERIAL_LOG_STREAM_SAMPLE, 0},
+ *     {"B", &current_b, SERIAL_LOG_STREAM_SAMPLE, 0}
+ * };
+ * SERIAL_LOG_STATIC_OUTPUT(coil_log, "Coil Currents", 10000, 300, 2, coil_streams);
+ * and serial_log_output_static(&coil_log) after serial_log_init
+ */
+#define SERIAL_LOG_STATIC_OUTPUT(name, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams) \
+    SERIAL_LOG_STATIC_GROUP_OUTPUT(name, 0, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams)
+#define SERIAL_LOG_STATIC_GROUP_OUTPUT(name, sample_group, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams) \
+    static log_t name##_log; \
+    static log_stream_t name##_streams[stream_count]; \
+    static log_stream_t *name##_stream_ptrs[stream_count]; \
+    static log_stream_data_t name##_buffers[(stream_count)*MAX_STREAM_DATA_BUFFERS]; \
+    static uint32_t name##_data[(stream_count)*MAX_STREAM_DATA_BUFFERS*SERIAL_LOG_STATIC_SAMPLES(sampling_rate_in_hz, bandwidth_in_hz)]; \
+    static const serial_log_static_t name = {title, bandwidth_in_hz, stream_count, streams, \
+        SERIAL_LOG_STATIC_SAMPLES(sampling_rate_in_hz, bandwidth_in_hz), &name##_log, name##_streams, name##_stream_ptrs, name##_buffers, name##_data, sample_group}
+
+//handle of a static log for the functions that take a log, valid once it is registered
+#define SERIAL_LOG_STATIC_HANDLE(name) ((void *)&name##_log)
+
+/*
+ * Declares every log of an X-macro list and a table of them. Every entry of the list is
+ * X(name, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams).
+ *
+ * For e.g.
+ * #define MOTOR_LOGS(X) \
+ *     X(coil_log, "Coil Currents", 10000, 300, 2, coil_streams) \
+ *     X(speed_log, "Speed", 10000, 50, 1, speed_streams)
+ * SERIAL_LOG_STATIC_TABLE(motor_logs, MOTOR_LOGS);
+ * and serial_log_output_static(motor_logs[i]) for every log of the table after serial_log_init
+ */
+#define SERIAL_LOG_STATIC_DECLARE(name, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams) \
+    SERIAL_LOG_STATIC_OUTPUT(name, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams);
+#define SERIAL_LOG_STATIC_ENTRY(name, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams) &name,
+#define SERIAL_LOG_STATIC_TABLE(table_name, LOGS) \
+    LOGS(SERIAL_LOG_STATIC_DECLARE) \
+    static const serial_log_static_t * const table_name[] = { LOGS(SERIAL_LOG_STATIC_ENTRY) }
+
+/*
+ * Registers a log declared with SERIAL_LOG_STATIC_OUTPUT in the sample group selected by serial_log_use_sample_group.
+ * Nothing is allocated or copied. The log can be closed with serial_log_close and registered again once it was released.
+ */
+void *serial_log_output_static(const serial_log_static_t *static_ptr);
+
+/*
+ * Declares a static log in any module and puts a pointer to it in the serial_log_table section. When the library
+ * is built with SERIAL_LOG_LINKER_TABLE, serial_log_init registers every log of the section that belongs to sample
+ * group 0 and serial_log_init_sample_group registers the ones of its group. The linker has to collect the section
+ * between serial_log_table_start and serial_log_table_end, see 28069_RAM_lnk.cmd and port/host/serial_log_table.ld.
+ *
+ * For e.g. in motor_control.c
+ * static const serial_log_stream_t coil_streams[] = {{"A", &current_a, SERIAL_LOG_STREAM_SAMPLE, 0}};
+ * SERIAL_LOG_REGISTER(coil_log, 0, "Coil Currents", 10000, 300, 1, coil_streams);
+ * and serial_log_set_trigger(SERIAL_LOG_STATIC_HANDLE(coil_log), &trigger) once it is registered
+ */
+#if defined(__TI_COMPILER_VERSION__)
+//the pragmas take the symbol and have to come before its definition. RETAIN keeps the unreferenced entry
+#define SERIAL_LOG_PRAGMA(x) _Pragma(#x)
+#define SERIAL_LOG_TABLE_ENTRY(symbol) SERIAL_LOG_PRAGMA(DATA_SECTION(symbol, "serial_log_table")) SERIAL_LOG_PRAGMA(RETAIN(symbol))
+#elif defined(__GNUC__)
+#define SERIAL_LOG_TABLE_ENTRY(symbol) __attribute__((section("serial_log_table"), used))
+#else
+#error "SERIAL_LOG_REGISTER needs a way to place a variable in a section"
+#endif
+#define SERIAL_LOG_REGISTER(name, sample_group, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams) \
+    SERIAL_LOG_STATIC_GROUP_OUTPUT(name, sample_group, title, sampling_rate_in_hz, bandwidth_in_hz, stream_count, streams); \
+    SERIAL_LOG_TABLE_ENTRY(name##_entry) static const serial_log_static_t * const name##_entry = &name
+
+#endif /* SERIAL_LOG_STATIC_H_ */
@@ -14,96 +14,194 @@
 
 #define STREAM_INFO_PERIOD  2000 //2secons interval for sending the stream info
 
-typedef struct in_transit_buffer_info_t {
-    uint8_t stream_index;
-    uint8_t buffer_index;
-}in_transit_buffer_info_t;
+//the host tells link commands apart from log packets by their first byte
+#if MAX_LOGS >= LOG_LINK_COMMAND_INDEX
+#error "MAX_LOGS has to stay below LOG_LINK_COMMAND_INDEX"
+#endif
 
-static uint8_t input_rx[6];
+extern int serial_log_str_length(char *str);
+extern char *serial_log_get_packed_name(log_t *log_ptr, char *name, char *packed_name);
+extern void serial_log_release_buffer(log_stream_t *log_stream_ptr, uint8_t buffer_index);
 
-extern log_t *logs[MAX_LOGS];
+static void start_uart_packet(serial_log_stream_context_t *context, serial_log_stream_state_t next_state)
+{
+  serial_log_packet_start(&context->tx_packet);
+  context->state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
+  context->uart_state_on_finish_sending_data = next_state;
+}
 
-static serial_log_stream_state_t serial_log_stream_state;
-static uint32_t current_time;
-static uint32_t last_stream_info_send_time;
+static void stop_uart_packet(serial_log_stream_context_t *context, serial_log_stream_state_t next_state)
+{
+  serial_log_packet_done(&context->tx_packet);
+  context->state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
+  context->uart_state_on_finish_sending_data = next_state;
+}
 
-static serial_log_stream_state_t uart_state_on_finish_sending_data;
-static log_t *in_transit_log_ptr;
-static uint8_t log_index, log_stream_index;
-static in_transit_buffer_info_t log_streams[MAX_LOG_STREAM_COUNT];
+static void send_uart_data(serial_log_stream_context_t *context, uint8_t *buffer, uint32_t data_size, serial_log_stream_state_t next_state)
+{
+    serial_log_packet_send(&context->tx_packet, buffer, data_size);
+    context->state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
+    context->uart_state_on_finish_sending_data = next_state;
+}
 
-static uint8_t stream_header[6];
-static bool log_info_packet_in_transit; //indicates if we are currently sending a log info packet
-static bool send_log_info_title; //indicates if we are sending title or name
 
-static serial_log_packet_t tx_packet;
-static serial_log_packet_t rx_packet;
+/*
+ * stores value as byte_count little endian bytes of the header. Returns the index of the next byte
+ */
+static uint8_t store_header_bytes(serial_log_stream_context_t *context, uint8_t index, uint32_t value, uint8_t byte_count)
+{
+    while(byte_count-- != 0)
+    {
+        serial_log_store_8bit(context->stream_header, index++, value&0xFF);
+        value >>= 8;
+    }
+    return index;
+}
 
-extern int serial_log_str_length(char *str);
+/*
+ * stores value in 7 bit groups starting from the least significant one. The top bit
+ * of every byte but the last is set. Returns the index of the next byte
+ */
+static uint8_t store_header_varint(serial_log_stream_context_t *context, uint8_t index, uint32_t value)
+{
+    while(value >= 0x80)
+    {
+        serial_log_store_8bit(context->stream_header, index++, (value&0x7F) | 0x80);
+        value >>= 7;
+    }
+    serial_log_store_8bit(context->stream_header, index++, value);
+    return index;
+}
 
-static void start_uart_packet(serial_log_stream_state_t next_state)
+/*
+ * protocol v2 headers start with the packet type followed by the log index
+ */
+static uint8_t store_v2_header(serial_log_stream_context_t *context, log_serial_packet_id_t packet_id)
 {
-  serial_log_packet_start(&tx_packet);
-  serial_log_stream_state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
-  uart_state_on_finish_sending_data = next_state;
+    serial_log_store_8bit(context->stream_header, 0, LOG_PACKET_V2_MARKER | packet_id);
+    return store_header_varint(context, 1, context->log_index);
 }
 
-static void stop_uart_packet(serial_log_stream_state_t next_state)
+/*
+ * number of logs that can be addressed in the packets of the protocol version
+ */
+static int get_max_logs(serial_log_stream_context_t *context)
 {
-  serial_log_packet_done(&tx_packet);
-  serial_log_stream_state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
-  uart_state_on_finish_sending_data = next_state;
+    if(context->protocol_version < SERIAL_LOG_PROTOCOL_V2 && MAX_LOGS > LOG_PACKET_V1_MAX_LOGS)
+    {
+        return LOG_PACKET_V1_MAX_LOGS;
+    }
+    return MAX_LOGS;
 }
 
-static void send_uart_data(uint8_t *buffer, uint32_t data_size, serial_log_stream_state_t next_state)
+/*
+ * number of streams of the log that can be addressed in the packets of the protocol version
+ */
+static int get_max_streams(serial_log_stream_context_t *context, log_t *log_ptr)
 {
-    serial_log_packet_send(&tx_packet, buffer, data_size);
-    serial_log_stream_state = SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE;
-    uart_state_on_finish_sending_data = next_state;
+    if(context->protocol_version < SERIAL_LOG_PROTOCOL_V2 && STREAM_COUNT(log_ptr) > LOG_PACKET_V1_MAX_STREAMS)
+    {
+        return LOG_PACKET_V1_MAX_STREAMS;
+    }
+    return STREAM_COUNT(log_ptr);
 }
 
+/*
+ * true if any of the ready buffers of the log holds compressed samples
+ */
+static bool has_compressed_buffer(log_t *log_ptr, in_transit_buffer_info_t *streams, int count)
+{
+    int j;
+    for(j = 0; j < count; ++j)
+    {
+        if(STREAMS(log_ptr)[streams[j].stream_index]->buffers[streams[j].buffer_index]->compressed)
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-static log_t *find_ready_stream_data_buffer(uint8_t *log_index, in_transit_buffer_info_t *streams)
+static log_t *find_ready_stream_data_buffer(serial_log_stream_context_t *context, uint8_t *log_index, in_transit_buffer_info_t *streams)
 {
     int i, j, k;
     int count;
     //check through all active logs to see if it is ready to be sent out through the serial port
-    for(i = 0; i < MAX_LOGS; ++i)
+    for(i = 0; i < get_max_logs(context); ++i)
     {
-        log_t *log_ptr = logs[i];
+        log_t *log_ptr = context->logs[i];
         if(log_ptr != NULL)
         {
             if(log_ptr->direction == LOG_OUTPUT)
             {
+                //buffers that the main loop compressed can always go out
+                bool compressed = serial_log_stream_is_compressed(context, log_ptr);
                 count = 0;
-                for(j = 0; j < MAX_LOG_STREAM_COUNT; ++j)
+                for(j = 0; j < STREAM_COUNT(log_ptr); ++j)
                 {
                     log_stream_t *log_stream_ptr = STREAMS(log_ptr)[j];//log_ptr->type.output.streams[j];
                     if(log_stream_ptr != NULL)
                     {
                         if(log_stream_ptr->in_use)
                         {
-                            for(k = 0; k < MAX_STREAM_DATA_BUFFERS; ++k)
+                            int ready_index = -1;
+                            for(k = 0; k < MAX_STREAM_BUFFER_SLOTS; ++k)
                             {
                                 log_stream_data_t *log_stream_data_ptr = log_stream_ptr->buffers[k];
-                                if(log_stream_data_ptr->state == SERIAL_LOG_DATA_READY)
+                                if(log_stream_data_ptr == NULL)
+                                    continue;
+                                if((log_stream_data_ptr->state == SERIAL_LOG_DATA_READY || log_stream_data_ptr->state == SERIAL_LOG_COMPRESSED_DATA_READY) &&
+                                   log_ptr->type.output.dropped_capture_id != 0 &&
+                                   log_stream_data_ptr->capture_id == log_ptr->type.output.dropped_capture_id)
                                 {
-                                    //this buffer is not active and has data filled in it. that means this is ready to go out
-                                    //log_stream_data_ptr->state = SERIAL_LOG_DATA_TRANSMITTING;
-                                    *log_index = (uint8_t)i;
-                                    in_transit_buffer_info_t *stream = streams + count++;
-                                    stream->stream_index = (uint8_t)j;
-                                    stream->buffer_index = (uint8_t)k;
-                                    //stream->data_offset = log_stream_data_ptr->data_offset;
-                                    //count++;
-                                    //return log_stream_data_ptr;
+                                    //the sampling side ran out of buffers during this capture. Only the main loop
+                                    //changes the state of a ready buffer so it is handed back from here
+                                    serial_log_release_buffer(log_stream_ptr, (uint8_t)k);
+                                    continue;
+                                }
+                                if(log_stream_data_ptr->state == SERIAL_LOG_COMPRESSED_DATA_READY ||
+                                   (log_stream_data_ptr->state == SERIAL_LOG_DATA_READY && !compressed))
+                                {
+                                    //this buffer is not active and has data filled in it. that means this is ready to go out.
+                                    //buffers are reused in any order so the one that started filling first goes out first
+                                    if(ready_index < 0 ||
+                                       (int16_t)(log_stream_data_ptr->sequence - log_stream_ptr->buffers[ready_index]->sequence) < 0)
+                                    {
+                                        ready_index = k;
+                                    }
                                 }
                             }
+                            if(ready_index >= 0)
+                            {
+                                *log_index = (uint8_t)i;
+                                in_transit_buffer_info_t *stream = streams + count++;
+                                stream->stream_index = (uint8_t)j;
+                                stream->buffer_index = (uint8_t)ready_index;
+                            }
                         }
                     }
                 }
                 if(count == STREAM_COUNT(log_ptr)) //log_ptr->type.output.stream_count)
                 {
+                    //compressed buffers that are left from before the host went back to protocol v1 cannot be sent
+                    if(context->protocol_version < SERIAL_LOG_PROTOCOL_V2 && has_compressed_buffer(log_ptr, streams, count))
+                    {
+                        for(j = 0; j < count; ++j)
+                        {
+                            serial_log_release_buffer(STREAMS(log_ptr)[streams[j].stream_index], streams[j].buffer_index);
+                        }
+                        continue;
+                    }
+                    //claim the buffers right away. The sampling side never changes the state of a ready buffer
+                    for(j = 0; j < get_max_streams(context, log_ptr); ++j)
+                    {
+                        STREAMS(log_ptr)[streams[j].stream_index]->buffers[streams[j].buffer_index]->state = SERIAL_LOG_DATA_TRANSMITTING;
+                    }
+                    //streams that the protocol cannot address are dropped so that the log keeps capturing
+                    for(; j < count; ++j)
+                    {
+                        serial_log_release_buffer(STREAMS(log_ptr)[streams[j].stream_index], streams[j].buffer_index);
+                    }
                     return log_ptr;
                 }
             }
@@ -112,320 +210,533 @@ static log_t *find_ready_stream_data_buffer(uint8_t *log_index, in_transit_buffe
     return NULL;
 }
 
-static void handle_inactive_state()
+static void handle_inactive_state(serial_log_stream_context_t *context)
 {
-    if(current_time - last_stream_info_send_time > STREAM_INFO_PERIOD)
+    if(context->requested_protocol_version != context->protocol_version)
+    {
+        //packets only change their format in between packets
+        context->protocol_version = context->requested_protocol_version;
+        if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+        {
+            start_uart_packet(context, SERIAL_LOG_STREAM_SEND_PROTOCOL);
+            return;
+        }
+    }
+    if(context->current_time - context->last_stream_info_send_time > STREAM_INFO_PERIOD)
     {
-        last_stream_info_send_time = current_time;
-        log_index = 0;
-        log_stream_index = 0;
-        serial_log_stream_state = SERIAL_LOG_STREAM_START_INFO;
+        context->last_stream_info_send_time = context->current_time;
+        context->log_index = 0;
+        context->log_stream_index = 0;
+        context->state = SERIAL_LOG_STREAM_START_INFO;
     }
     else
     {
-        in_transit_log_ptr = find_ready_stream_data_buffer(&log_index, log_streams);
-        log_stream_index = 0;
-        if(in_transit_log_ptr == NULL)
+        context->in_transit_log_ptr = find_ready_stream_data_buffer(context, &context->log_index, context->log_streams);
+        context->log_stream_index = 0;
+        if(context->in_transit_log_ptr == NULL)
         {
             //we don't have any filled transit buffer. keep checking and wait for one
             return;
         }
-        start_uart_packet(SERIAL_LOG_STREAM_SEND_DATA_HEADER);
+        start_uart_packet(context, SERIAL_LOG_STREAM_SEND_DATA_HEADER);
     }
 }
 
-static void handle_stream_data_done_state()
+static void handle_stream_data_done_state(serial_log_stream_context_t *context)
 {
-    uint8_t stream_index = log_streams[log_stream_index].stream_index;
-    uint8_t buffer_index = log_streams[log_stream_index].buffer_index;
-    log_stream_data_t *in_transit_log_stream_data_ptr = STREAMS(in_transit_log_ptr)[stream_index]->buffers[buffer_index]; //in_transit_log_ptr->type.output.streams[stream_index]->buffers[buffer_index];
-    in_transit_log_stream_data_ptr->state = SERIAL_LOG_DATA_NOT_SET; //indicates to the bit packing that this is now available for filling
-    log_stream_index++;
+    uint8_t stream_index = context->log_streams[context->log_stream_index].stream_index;
+    uint8_t buffer_index = context->log_streams[context->log_stream_index].buffer_index;
+    serial_log_release_buffer(STREAMS(context->in_transit_log_ptr)[stream_index], buffer_index); //indicates to the bit packing that this is now available for filling
+    context->log_stream_index++;
 
-    if(log_stream_index < STREAM_COUNT(in_transit_log_ptr)) //in_transit_log_ptr->type.output.stream_count)
+    if(context->log_stream_index < get_max_streams(context, context->in_transit_log_ptr)) //in_transit_log_ptr->type.output.stream_count)
     {
         //start_uart_packet(SERIAL_LOG_STREAM_SEND_DATA_HEADER);
-        serial_log_stream_state = SERIAL_LOG_STREAM_SEND_DATA_HEADER;
+        context->state = SERIAL_LOG_STREAM_SEND_DATA_HEADER;
     }
     else
     {
-        stop_uart_packet(SERIAL_LOG_STREAM_INACTIVE);
+        stop_uart_packet(context, SERIAL_LOG_STREAM_INACTIVE);
     }
 }
 
 
-static void handle_send_stream_data_header_state()
+static void handle_send_stream_data_header_state(serial_log_stream_context_t *context)
 {
-    uint8_t stream_index = log_streams[log_stream_index].stream_index;
-    uint8_t buffer_index = log_streams[log_stream_index].buffer_index;
-    log_stream_data_t *in_transit_log_stream_data_ptr = STREAMS(in_transit_log_ptr)[stream_index]->buffers[buffer_index];  //in_transit_log_ptr->type.output.streams[stream_index]->buffers[buffer_index];
+    uint8_t stream_index = context->log_streams[context->log_stream_index].stream_index;
+    uint8_t buffer_index = context->log_streams[context->log_stream_index].buffer_index;
+    log_stream_data_t *in_transit_log_stream_data_ptr = STREAMS(context->in_transit_log_ptr)[stream_index]->buffers[buffer_index];  //in_transit_log_ptr->type.output.streams[stream_index]->buffers[buffer_index];
     uint32_t bytes = in_transit_log_stream_data_ptr->data_bits;
 
     bytes = (bytes + 8 - 1)>>3; //ceil operation
     uint32_t offset = in_transit_log_stream_data_ptr->data_offset;
+    uint8_t index;
+    if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+    {
+        index = store_v2_header(context, in_transit_log_stream_data_ptr->compressed?LOG_STREAM_COMPRESSED_DATA_PACKET_ID:LOG_STREAM_DATA_PACKET_ID);
+        index = store_header_varint(context, index, stream_index);
+        index = store_header_bytes(context, index, bytes, 4);
+        index = store_header_bytes(context, index, offset, 4);
+        //the host places the buffer by the tick of its first sample and the capture it belongs to
+        index = store_header_bytes(context, index, in_transit_log_stream_data_ptr->sample_tick, 4);
+        index = store_header_bytes(context, index, in_transit_log_stream_data_ptr->capture_id, 4);
+        index = store_header_bytes(context, index, in_transit_log_stream_data_ptr->trigger_position, 2);
+        index = store_header_bytes(context, index, in_transit_log_stream_data_ptr->history_start, 2);
+        if(in_transit_log_stream_data_ptr->compressed)
+        {
+            //the host cannot tell the padding of the last byte from unchanged samples
+            index = store_header_bytes(context, index, in_transit_log_stream_data_ptr->sample_count, 4);
+        }
+        send_uart_data(context, context->stream_header, index, SERIAL_LOG_STREAM_SEND_DATA);
+        return;
+    }
     /*if(in_transit_log_stream_data_ptr->triggered)
     {
        bytes |= 0x8000; //indicating that a trigger happened
     }*/
 
-    serial_log_store_8bit(stream_header, 0, ((LOG_STREAM_DATA_PACKET_ID&0x3) << 6) | ((stream_index&0x3) << 4) | (log_index&0xF));
-    serial_log_store_8bit(stream_header, 1, bytes&0xFF);
-    serial_log_store_8bit(stream_header, 2, (bytes>>8)&0xFF);
-    serial_log_store_8bit(stream_header, 3, offset&0xFF);
-    serial_log_store_8bit(stream_header, 4, (offset>>8)&0xFF);
-    send_uart_data(stream_header, 5, SERIAL_LOG_STREAM_SEND_DATA);
+    serial_log_store_8bit(context->stream_header, 0, ((LOG_STREAM_DATA_PACKET_ID&0x3) << 6) | ((stream_index&0x3) << 4) | (context->log_index&0xF));
+    serial_log_store_8bit(context->stream_header, 1, bytes&0xFF);
+    serial_log_store_8bit(context->stream_header, 2, (bytes>>8)&0xFF);
+    serial_log_store_8bit(context->stream_header, 3, offset&0xFF);
+    serial_log_store_8bit(context->stream_header, 4, (offset>>8)&0xFF);
+    //the trigger position, history start and capture id are only sent once the host asked for protocol v2
+    send_uart_data(context, context->stream_header, 5, SERIAL_LOG_STREAM_SEND_DATA);
 }
 
 
-static void handle_send_stream_data_state()
+static void handle_send_stream_data_state(serial_log_stream_context_t *context)
 {
-    uint8_t stream_index = log_streams[log_stream_index].stream_index;
-    uint8_t buffer_index = log_streams[log_stream_index].buffer_index;
-    log_stream_data_t *in_transit_log_stream_data_ptr = STREAMS(in_transit_log_ptr)[stream_index]->buffers[buffer_index]; //in_transit_log_ptr->type.output.streams[stream_index]->buffers[buffer_index];
+    uint8_t stream_index = context->log_streams[context->log_stream_index].stream_index;
+    uint8_t buffer_index = context->log_streams[context->log_stream_index].buffer_index;
+    log_stream_data_t *in_transit_log_stream_data_ptr = STREAMS(context->in_transit_log_ptr)[stream_index]->buffers[buffer_index]; //in_transit_log_ptr->type.output.streams[stream_index]->buffers[buffer_index];
     uint32_t bytes = in_transit_log_stream_data_ptr->data_bits;
     bytes = (bytes + 8 - 1)>>3; //ceil operation
     in_transit_log_stream_data_ptr->state = SERIAL_LOG_DATA_TRANSMITTING;
-    send_uart_data((uint8_t *)in_transit_log_stream_data_ptr->data_ptr,
+    send_uart_data(context, (uint8_t *)in_transit_log_stream_data_ptr->data_ptr,
                   bytes,
                   SERIAL_LOG_STREAM_DATA_DONE);
 }
 
 
-static void handle_start_stream_info_state()
+/*
+ * number of streams whose info is sent for the log at the log index
+ */
+static int get_info_stream_count(serial_log_stream_context_t *context)
+{
+    log_t *log_ptr = (context->log_index < MAX_LOGS)?context->logs[context->log_index]:NULL;
+    if(log_ptr == NULL || log_ptr->direction != LOG_OUTPUT)
+    {
+        //only output logs go through their streams
+        return MAX_LOG_STREAM_COUNT;
+    }
+    return get_max_streams(context, log_ptr);
+}
+
+static void handle_start_stream_info_state(serial_log_stream_context_t *context)
 {
     log_t *log_ptr;
-    if(log_stream_index >= MAX_LOG_STREAM_COUNT)
+    if(context->log_stream_index >= get_info_stream_count(context))
     {
         //we reached the end of this log's stream so go to the next one's title
-        log_stream_index = 0;
-        send_log_info_title = true;
-        ++log_index;
+        context->log_stream_index = 0;
+        context->send_log_info_title = true;
+        ++context->log_index;
     }
 
-    if(log_index >= MAX_LOGS)
+    if(context->log_index >= get_max_logs(context))
     {
         //we scanned through the entire log info list now go back to the inactive state
-        if(log_info_packet_in_transit)
+        if(context->log_info_packet_in_transit)
         {
             //we send out an info packet so close it now
-            stop_uart_packet(SERIAL_LOG_STREAM_INACTIVE);
+            stop_uart_packet(context, SERIAL_LOG_STREAM_INACTIVE);
         }
-        log_info_packet_in_transit = false;
-        log_index = 0;
+        context->log_info_packet_in_transit = false;
+        context->log_index = 0;
         return;
     }
 
-    if(logs[log_index] != NULL)
+    if(context->logs[context->log_index] != NULL)
     {
-        log_ptr = logs[log_index];
+        log_ptr = context->logs[context->log_index];
         if(log_ptr->direction == LOG_OUTPUT)
         {
-            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[log_stream_index]; //logs[log_index]->type.output.streams[log_stream_index];
+            log_stream_t *log_stream_ptr = STREAMS(log_ptr)[context->log_stream_index]; //logs[log_index]->type.output.streams[log_stream_index];
             if(log_stream_ptr != NULL)
             {
                 if(log_stream_ptr->in_use)
                 {
-                    if(!log_info_packet_in_transit)
+                    if(!context->log_info_packet_in_transit)
                     {
-                        log_info_packet_in_transit = true;
-                        start_uart_packet(SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER);
+                        context->log_info_packet_in_transit = true;
+                        start_uart_packet(context, SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER);
                     }
                     else
                     {
-                        serial_log_stream_state = send_log_info_title?SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER:\
+                        context->state = context->send_log_info_title?SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER:\
                                                             SERIAL_LOG_STREAM_SEND_INFO_NAME_HEADER;
                     }
-                    send_log_info_title = false; //next iteration has to be names
+                    context->send_log_info_title = false; //next iteration has to be names
                     return;
                 }
             }
-            ++log_stream_index;
+            ++context->log_stream_index;
             return;
         }
         else if(log_ptr->direction == LOG_INPUT)
         {
-            if(!log_info_packet_in_transit)
+            if(!context->log_info_packet_in_transit)
             {
-                log_info_packet_in_transit = true;
-                start_uart_packet(SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER);
+                context->log_info_packet_in_transit = true;
+                start_uart_packet(context, SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER);
             }
             else
             {
-                serial_log_stream_state = send_log_info_title?SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER:\
+                context->state = context->send_log_info_title?SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER:\
                                                                                     SERIAL_LOG_STREAM_SEND_INPUT_HEADER;
             }
-            send_log_info_title = false; //next iteration has to be names
+            context->send_log_info_title = false; //next iteration has to be names
             return;
         }
     }
 
     //go to the next log since this one was not in use
-    ++log_index;
+    ++context->log_index;
 
 }
 
-static void handle_send_stream_info_title_header_state()
+static void handle_send_stream_info_title_header_state(serial_log_stream_context_t *context)
 {
-    serial_log_store_8bit(stream_header, 0, ((LOG_STREAM_INFO_TITLE_PACKET_ID&0x3) << 6) | ((log_stream_index&0x3) << 4) | (log_index&0xF));
-    send_uart_data(stream_header, 1, SERIAL_LOG_STREAM_SEND_INFO_TITLE);
+    if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+    {
+        send_uart_data(context, context->stream_header, store_v2_header(context, LOG_STREAM_INFO_TITLE_PACKET_ID), SERIAL_LOG_STREAM_SEND_INFO_TITLE);
+        return;
+    }
+    serial_log_store_8bit(context->stream_header, 0, ((LOG_STREAM_INFO_TITLE_PACKET_ID&0x3) << 6) | ((context->log_stream_index&0x3) << 4) | (context->log_index&0xF));
+    send_uart_data(context, context->stream_header, 1, SERIAL_LOG_STREAM_SEND_INFO_TITLE);
 }
-static void handle_send_stream_info_title_state()
+static void handle_send_stream_info_title_state(serial_log_stream_context_t *context)
 {
-    char *title = (char *)logs[log_index]->title;
+    char *title = serial_log_get_packed_name(context->logs[context->log_index], context->logs[context->log_index]->title, context->packed_name);
     //uint8_t length = strlen(title)+1;
     uint8_t length = serial_log_str_length(title);//logs[log_index].title_length+1;
     if(length > MAX_NAME_SIZE)
         length = MAX_NAME_SIZE;
-    send_uart_data((uint8_t *)title, length+1, SERIAL_LOG_STREAM_START_INFO);
+    send_uart_data(context, (uint8_t *)title, length+1, SERIAL_LOG_STREAM_START_INFO);
 }
 
-static void handle_stream_info_input_done_state()
+static void handle_stream_info_input_done_state(serial_log_stream_context_t *context)
 {
     //go to the next stream
-    ++log_index;
-    send_log_info_title = true; //inputs only have title;
-    serial_log_stream_state = SERIAL_LOG_STREAM_START_INFO;
+    ++context->log_index;
+    context->send_log_info_title = true; //inputs only have title;
+    context->state = SERIAL_LOG_STREAM_START_INFO;
 }
 
-static void handle_send_stream_info_input_header_state()
+static void handle_send_stream_info_input_header_state(serial_log_stream_context_t *context)
 {
-    log_t *log_ptr = logs[log_index];
+    log_t *log_ptr = context->logs[context->log_index];
     int value = log_ptr->type.input.value;
-    serial_log_store_8bit(stream_header, 0, ((LOG_STREAM_INFO_INPUT_PACKET_ID&0x3) << 6) );
-    serial_log_store_8bit(stream_header, 1, (uint8_t)value);
-    serial_log_store_8bit(stream_header, 2, (uint8_t)(value>>8));
-    send_uart_data(stream_header, 3, SERIAL_LOG_STREAM_INFO_INPUT_DONE);
+    if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+    {
+        uint8_t index = store_v2_header(context, LOG_STREAM_INFO_INPUT_PACKET_ID);
+        index = store_header_bytes(context, index, (uint16_t)value, 2);
+        send_uart_data(context, context->stream_header, index, SERIAL_LOG_STREAM_INFO_INPUT_DONE);
+        return;
+    }
+    serial_log_store_8bit(context->stream_header, 0, ((LOG_STREAM_INFO_INPUT_PACKET_ID&0x3) << 6) );
+    serial_log_store_8bit(context->stream_header, 1, (uint8_t)value);
+    serial_log_store_8bit(context->stream_header, 2, (uint8_t)(value>>8));
+    send_uart_data(context, context->stream_header, 3, SERIAL_LOG_STREAM_INFO_INPUT_DONE);
 }
 
-static void handle_send_stream_info_name_header_state()
+static void handle_send_stream_info_name_header_state(serial_log_stream_context_t *context)
 {
-    serial_log_store_8bit(stream_header, 0, ((LOG_STREAM_INFO_NAME_PACKET_ID&0x3) << 6) | ((log_stream_index&0x3) << 4) | (log_index&0xF));
-    serial_log_store_8bit(stream_header, 1, STREAMS(logs[log_index])[log_stream_index]->type_length_in_bits);
-
-    send_uart_data(stream_header, 2, SERIAL_LOG_STREAM_SEND_INFO_NAME);
+    if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+    {
+        uint8_t index = store_v2_header(context, LOG_STREAM_INFO_NAME_PACKET_ID);
+        index = store_header_varint(context, index, context->log_stream_index);
+        serial_log_store_8bit(context->stream_header, index++, STREAMS(context->logs[context->log_index])[context->log_stream_index]->type_length_in_bits);
+        serial_log_store_8bit(context->stream_header, index++, STREAMS(context->logs[context->log_index])[context->log_stream_index]->mode);
+        send_uart_data(context, context->stream_header, index, SERIAL_LOG_STREAM_SEND_INFO_NAME);
+        return;
+    }
+    serial_log_store_8bit(context->stream_header, 0, ((LOG_STREAM_INFO_NAME_PACKET_ID&0x3) << 6) | ((context->log_stream_index&0x3) << 4) | (context->log_index&0xF));
+    serial_log_store_8bit(context->stream_header, 1, STREAMS(context->logs[context->log_index])[context->log_stream_index]->type_length_in_bits);
+    //the stream mode is only sent once the host asked for protocol v2
+    send_uart_data(context, context->stream_header, 2, SERIAL_LOG_STREAM_SEND_INFO_NAME);
 }
 
-static void handle_send_stream_info_name_state()
+static void handle_send_stream_info_name_state(serial_log_stream_context_t *context)
 {
-    char *name= (char *)STREAMS(logs[log_index])[log_stream_index]->name; //(char *)logs[log_index]->type.output.streams[log_stream_index]->name;
+    char *name= serial_log_get_packed_name(context->logs[context->log_index], STREAMS(context->logs[context->log_index])[context->log_stream_index]->name, context->packed_name); //(char *)logs[log_index]->type.output.streams[log_stream_index]->name;
     uint8_t length = serial_log_str_length(name);
     if(length > MAX_NAME_SIZE)
         length = MAX_NAME_SIZE;
-    send_uart_data((uint8_t *)name, length+1, SERIAL_LOG_STREAM_INFO_NAME_DONE);
+    send_uart_data(context, (uint8_t *)name, length+1, SERIAL_LOG_STREAM_INFO_NAME_DONE);
 }
 
-static void handle_stream_info_name_done_state()
+static void handle_stream_info_name_done_state(serial_log_stream_context_t *context)
 {
     //go to the next stream
-    ++log_stream_index;
-    serial_log_stream_state = SERIAL_LOG_STREAM_START_INFO;
+    ++context->log_stream_index;
+    context->state = SERIAL_LOG_STREAM_START_INFO;
+}
+
+static void handle_send_protocol_state(serial_log_stream_context_t *context)
+{
+    serial_log_store_8bit(context->stream_header, 0, LOG_PACKET_V2_MARKER | LOG_STREAM_PROTOCOL_PACKET_ID);
+    serial_log_store_8bit(context->stream_header, 1, context->protocol_version);
+    send_uart_data(context, context->stream_header, 2, SERIAL_LOG_STREAM_PROTOCOL_DONE);
+}
+
+static void handle_protocol_done_state(serial_log_stream_context_t *context)
+{
+    stop_uart_packet(context, SERIAL_LOG_STREAM_INACTIVE);
+    //the host needs the info of every log again in the new format
+    context->last_stream_info_send_time = context->current_time - STREAM_INFO_PERIOD - 1;
+}
+
+static void handle_send_byte_ack_wait_state(serial_log_stream_context_t *context)
+{
+    if(!is_serial_log_packet_tx_busy(&context->tx_packet))
+      context->state = context->uart_state_on_finish_sending_data;
+}
+
+/*
+ * reads a little endian 32 bit float from the received packet
+ */
+static float read_float(uint8_t *buffer, int byte_index)
+{
+    float result;
+    uint32_t value = serial_log_read_8bit(buffer, byte_index);
+    value |= ((uint32_t)serial_log_read_8bit(buffer, byte_index+1) << 8);
+    value |= ((uint32_t)serial_log_read_8bit(buffer, byte_index+2) << 16);
+    value |= ((uint32_t)serial_log_read_8bit(buffer, byte_index+3) << 24);
+    memcpy(&result, &value, sizeof(result));
+    return result;
+}
+
+/*
+ * the command follows the log index at index in the received packet
+ */
+static void rx_output_command_handler(log_t *log_ptr, uint8_t *buffer, int index)
+{
+    serial_log_trigger_t trigger;
+    switch(serial_log_read_8bit(buffer, index))
+    {
+    case LOG_COMMAND_SET_TRIGGER:
+        trigger.mode = (log_trigger_mode_t)serial_log_read_8bit(buffer, index+1);
+        trigger.edge = (log_trigger_edge_t)serial_log_read_8bit(buffer, index+2);
+        trigger.source_stream = serial_log_read_8bit(buffer, index+3);
+        trigger.level = read_float(buffer, index+4);
+        trigger.hysteresis = read_float(buffer, index+8);
+        trigger.slope = read_float(buffer, index+12);
+        serial_log_set_trigger(log_ptr, &trigger);
+        break;
+
+    case LOG_COMMAND_FORCE_TRIGGER:
+        serial_log_force_trigger(log_ptr);
+        break;
+
+    case LOG_COMMAND_SET_SPECTRUM_BINS:
+        serial_log_set_spectrum_bins(log_ptr, serial_log_read_8bit(buffer, index+1) | (serial_log_read_8bit(buffer, index+2) << 8));
+        break;
+
+    default:
+        break;
+    }
+}
+
+/*
+ * reads the varint at index of the received packet and moves index past it
+ */
+static uint32_t read_varint(uint8_t *buffer, int *index)
+{
+    uint32_t value = 0;
+    uint8_t shift = 0;
+    uint8_t data;
+    do
+    {
+        data = serial_log_read_8bit(buffer, (*index)++);
+        value |= (uint32_t)(data&0x7F) << shift;
+        shift += 7;
+    } while((data&0x80) != 0 && shift < 32);
+    return value;
 }
 
-static void handle_send_byte_ack_wait_state()
+static void rx_link_command_handler(serial_log_stream_context_t *context, uint8_t *buffer)
 {
-    if(!is_serial_log_packet_tx_busy(&tx_packet))
-      serial_log_stream_state = uart_state_on_finish_sending_data;
+    uint8_t version;
+    switch(serial_log_read_8bit(buffer, 1))
+    {
+    case LOG_LINK_COMMAND_SET_PROTOCOL:
+        //a host that knows a newer protocol gets the newest one known here
+        version = serial_log_read_8bit(buffer, 2);
+        if(version > SERIAL_LOG_PROTOCOL_V2)
+            version = SERIAL_LOG_PROTOCOL_V2;
+        if(version >= SERIAL_LOG_PROTOCOL_V1)
+            context->requested_protocol_version = version;
+        break;
+
+    default:
+        break;
+    }
 }
 
 static void rx_packet_handler(serial_log_packet_t *serial_log_packet_ptr)
 {
     log_t *log_ptr;
-    uint8_t log_index = serial_log_read_8bit(serial_log_packet_ptr->buffer, 0);
+    serial_log_stream_context_t *context = (serial_log_stream_context_t *)serial_log_packet_ptr->owner;
+    uint32_t log_index;
+    int index = 0;
+
+    //no log index starts with this byte. In protocol v1 it is a raw byte below MAX_LOGS and in protocol v2
+    //only the varints of 255 and above start with it, e.g. 127 is the single byte 0x7F
+    if(serial_log_read_8bit(serial_log_packet_ptr->buffer, 0) == LOG_LINK_COMMAND_INDEX)
+    {
+        rx_link_command_handler(context, serial_log_packet_ptr->buffer);
+        return;
+    }
+    //protocol v2 hosts send the log index as a varint
+    if(context->protocol_version >= SERIAL_LOG_PROTOCOL_V2)
+        log_index = read_varint(serial_log_packet_ptr->buffer, &index);
+    else
+        log_index = serial_log_read_8bit(serial_log_packet_ptr->buffer, index++);
 
     if(log_index < MAX_LOGS)
     {
-        log_ptr = logs[log_index];
+        log_ptr = context->logs[log_index];
         if(log_ptr != NULL)
         {
             if(log_ptr->direction == LOG_INPUT)
             {
-                uint16_t value = serial_log_read_8bit(serial_log_packet_ptr->buffer, 1);
-                value |= (serial_log_read_8bit(serial_log_packet_ptr->buffer, 2) << 8);
+                uint16_t value = serial_log_read_8bit(serial_log_packet_ptr->buffer, index);
+                value |= (serial_log_read_8bit(serial_log_packet_ptr->buffer, index+1) << 8);
 
                 //uint16_t value = serial_log_packet_ptr->buffer[1] | (serial_log_packet_ptr->buffer[2] << 8);
                 log_ptr->type.input.value = value;
                 if(log_ptr->type.input.func != NULL)
                     log_ptr->type.input.func(value);
             }
+            else if(log_ptr->direction == LOG_OUTPUT)
+            {
+                rx_output_command_handler(log_ptr, serial_log_packet_ptr->buffer, index);
+            }
         }
     }
 }
 
-void serial_log_stream_handler(uint32_t in_current_time)
+void serial_log_stream_handler(serial_log_stream_context_t *context, uint32_t in_current_time)
 {
     //current_time = serial_log_get_time_ms();
-    current_time = in_current_time;
-    switch(serial_log_stream_state)
+    context->current_time = in_current_time;
+    switch(context->state)
     {
     case SERIAL_LOG_STREAM_INACTIVE:
-        handle_inactive_state();
+        handle_inactive_state(context);
         break;
 
     case SERIAL_LOG_STREAM_SEND_DATA_HEADER:
-        handle_send_stream_data_header_state();
+        handle_send_stream_data_header_state(context);
         break;
     case SERIAL_LOG_STREAM_SEND_DATA:
-        handle_send_stream_data_state();
+        handle_send_stream_data_state(context);
         break;
 
     case SERIAL_LOG_STREAM_DATA_DONE:
-        handle_stream_data_done_state();
+        handle_stream_data_done_state(context);
         break;
 
 
     case SERIAL_LOG_STREAM_START_INFO:
-        handle_start_stream_info_state();
+        handle_start_stream_info_state(context);
         break;
     case SERIAL_LOG_STREAM_SEND_INFO_TITLE_HEADER:
-        handle_send_stream_info_title_header_state();
+        handle_send_stream_info_title_header_state(context);
         break;
     case SERIAL_LOG_STREAM_SEND_INFO_TITLE:
-        handle_send_stream_info_title_state();
+        handle_send_stream_info_title_state(context);
         break;
     case SERIAL_LOG_STREAM_SEND_INPUT_HEADER:
-        handle_send_stream_info_input_header_state();
+        handle_send_stream_info_input_header_state(context);
         break;
     case SERIAL_LOG_STREAM_INFO_INPUT_DONE:
-        handle_stream_info_input_done_state();
+        handle_stream_info_input_done_state(context);
         break;
 
     case SERIAL_LOG_STREAM_SEND_INFO_NAME_HEADER:
-        handle_send_stream_info_name_header_state();
+        handle_send_stream_info_name_header_state(context);
         break;
     case SERIAL_LOG_STREAM_SEND_INFO_NAME:
-        handle_send_stream_info_name_state();
+        handle_send_stream_info_name_state(context);
         break;
     case SERIAL_LOG_STREAM_INFO_NAME_DONE:
-        handle_stream_info_name_done_state();
+        handle_stream_info_name_done_state(context);
        break;
     
+    case SERIAL_LOG_STREAM_SEND_PROTOCOL:
+        handle_send_protocol_state(context);
+        break;
+    case SERIAL_LOG_STREAM_PROTOCOL_DONE:
+        handle_protocol_done_state(context);
+        break;
+
     case SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE:
-        handle_send_byte_ack_wait_state();
+        handle_send_byte_ack_wait_state(context);
         break;
     
     default:
         break;
     }
     
-    serial_log_packet_build_rx(&rx_packet, rx_packet_handler);
-    serial_log_packet_build_tx(&tx_packet);
-
-}
-
-void serial_log_stream_handler_init()
-{
-    serial_log_stream_state = SERIAL_LOG_STREAM_INACTIVE;
-    current_time = 0;
-    log_info_packet_in_transit = false;
-    send_log_info_title = true;
-    last_stream_info_send_time = 0;
-    in_transit_log_ptr = NULL;
-    memset(log_streams, 0, sizeof(log_streams));
-    memset(stream_header, 0, sizeof(stream_header));
-    serial_log_packet_reset_tx(&tx_packet);
-    serial_log_packet_reset_rx(&rx_packet);
-    rx_packet.buffer = input_rx;
-    rx_packet.length = sizeof(input_rx);
-    uart_state_on_finish_sending_data = SERIAL_LOG_STREAM_INACTIVE;
-    log_index = log_stream_index = 0;
+    serial_log_packet_build_rx(&context->rx_packet, rx_packet_handler);
+    serial_log_packet_build_tx(&context->tx_packet);
+
+}
+
+/*
+ * returns true if no packet is being built or sent
+ */
+bool is_serial_log_stream_idle(serial_log_stream_context_t *context)
+{
+    return context->state == SERIAL_LOG_STREAM_INACTIVE;
+}
+
+/*
+ * compressed buffers can only be decoded by hosts that use protocol v2
+ */
+bool serial_log_stream_is_compressed(serial_log_stream_context_t *context, log_t *log_ptr)
+{
+    return log_ptr->type.output.compress && context->protocol_version >= SERIAL_LOG_PROTOCOL_V2;
+}
+
+void serial_log_stream_handler_init(serial_log_stream_context_t *context, log_t **logs, const serial_log_link_t *link)
+{
+    context->logs = logs;
+    context->state = SERIAL_LOG_STREAM_INACTIVE;
+    context->current_time = 0;
+    context->log_info_packet_in_transit = false;
+    context->send_log_info_title = true;
+    context->last_stream_info_send_time = 0;
+    context->in_transit_log_ptr = NULL;
+    memset(context->log_streams, 0, sizeof(context->log_streams));
+    memset(context->stream_header, 0, sizeof(context->stream_header));
+    serial_log_packet_reset_tx(&context->tx_packet);
+    serial_log_packet_reset_rx(&context->rx_packet);
+    context->rx_packet.buffer = context->input_rx;
+    context->rx_packet.length = sizeof(context->input_rx);
+    context->rx_packet.owner = context;
+    context->tx_packet.link = context->rx_packet.link = NULL;
+    if(link != NULL)
+    {
+        //the link is kept with the instance so the caller does not have to keep it
+        context->link = *link;
+        context->tx_packet.link = context->rx_packet.link = &context->link;
+    }
+    context->uart_state_on_finish_sending_data = SERIAL_LOG_STREAM_INACTIVE;
+    context->log_index = context->log_stream_index = 0;
+    //hosts that do not ask for a newer protocol get the original packets
+    context->protocol_version = context->requested_protocol_version = SERIAL_LOG_PROTOCOL_V1;
 }
@@ -7,7 +7,7 @@
 
 #ifndef SERIAL_LOG_STREAM_H_
 #define SERIAL_LOG_STREAM_H_
-
+#include "serial_log_packet.h"
 
 typedef enum serial_log_stream_state_t
 {
@@ -27,6 +27,9 @@ typedef enum serial_log_stream_state_t
     SERIAL_LOG_STREAM_SEND_INPUT_HEADER,
     SERIAL_LOG_STREAM_INFO_INPUT_DONE,
 
+    SERIAL_LOG_STREAM_SEND_PROTOCOL,
+    SERIAL_LOG_STREAM_PROTOCOL_DONE,
+
     SERIAL_LOG_STREAM_SEND_BYTE,
     SERIAL_LOG_STREAM_SEND_ACK_WAIT_BYTE,
     SERIAL_LOG_STREAM_SEND_BYTE_ACK
@@ -38,10 +41,73 @@ typedef enum log_serial_packet_id_t
     LOG_STREAM_INFO_TITLE_PACKET_ID = 0,
     LOG_STREAM_INFO_NAME_PACKET_ID,
     LOG_STREAM_DATA_PACKET_ID,
-    LOG_STREAM_INFO_INPUT_PACKET_ID
+    LOG_STREAM_INFO_INPUT_PACKET_ID,
+    LOG_STREAM_PROTOCOL_PACKET_ID,  //only in protocol v2. Acknowledges the switch to a protocol version
+    LOG_STREAM_COMPRESSED_DATA_PACKET_ID //only in protocol v2. Data header followed by the number of compressed samples
 } log_serial_packet_id_t;
 
-void serial_log_stream_handler(uint32_t in_current_time);
-void serial_log_stream_handler_init();
+#define SERIAL_LOG_PROTOCOL_V1      1
+#define SERIAL_LOG_PROTOCOL_V2      2
+//packets of protocol v1 never use stream index 3 so protocol v2 types are told apart by this pattern
+#define LOG_PACKET_V2_MARKER        0x30
+#define LOG_PACKET_V1_MAX_LOGS      16  //log index of protocol v1 packets has 4 bits
+#define LOG_PACKET_V1_MAX_STREAMS   3   //stream index 3 of protocol v1 packets marks protocol v2 headers
+#define LOG_PACKET_MAX_HEADER_SIZE  28  //compressed data header of protocol v2 with the largest varints
+
+//log index of the packets from the host that are meant for the link instead of a log
+#define LOG_LINK_COMMAND_INDEX      0xFF
+
+typedef enum log_serial_link_command_id_t
+{
+    LOG_LINK_COMMAND_SET_PROTOCOL = 0   //protocol version that the host understands
+} log_serial_link_command_id_t;
+
+//commands sent by the host to an output log. Follows the log index in the received packet
+typedef enum log_serial_command_id_t
+{
+    LOG_COMMAND_SET_TRIGGER = 0,    //mode, edge, source stream, level, hysteresis and slope
+    LOG_COMMAND_FORCE_TRIGGER,
+    LOG_COMMAND_SET_SPECTRUM_BINS   //16 bit number of bins
+} log_serial_command_id_t;
+
+typedef struct in_transit_buffer_info_t {
+    uint8_t stream_index;
+    uint8_t buffer_index;
+}in_transit_buffer_info_t;
+
+/*
+ * state of the stream layer of a logger instance
+ */
+typedef struct serial_log_stream_context_t
+{
+    log_t **logs; //MAX_LOGS logs of the instance
+    serial_log_stream_state_t state;
+    uint32_t current_time;
+    uint32_t last_stream_info_send_time;
+
+    serial_log_stream_state_t uart_state_on_finish_sending_data;
+    log_t *in_transit_log_ptr;
+    uint8_t log_index, log_stream_index;
+    in_transit_buffer_info_t log_streams[MAX_LOG_STREAM_COUNT];
+
+    uint8_t stream_header[LOG_PACKET_MAX_HEADER_SIZE];
+    uint8_t protocol_version; //format of the packets sent to the host
+    uint8_t requested_protocol_version; //used from the next packet on
+    bool log_info_packet_in_transit; //indicates if we are currently sending a log info packet
+    bool send_log_info_title; //indicates if we are sending title or name
+    char packed_name[MAX_NAME_SIZE]; //title or name of a static log while it is being sent
+
+    serial_log_link_t link;
+    serial_log_packet_t tx_packet;
+    serial_log_packet_t rx_packet;
+    uint8_t input_rx[20]; //largest packet is the trigger configuration of an output log
+} serial_log_stream_context_t;
+
+void serial_log_stream_handler(serial_log_stream_context_t *context, uint32_t in_current_time);
+//link can be NULL to use the uart of the platform
+void serial_log_stream_handler_init(serial_log_stream_context_t *context, log_t **logs, const serial_log_link_t *link);
+bool is_serial_log_stream_idle(serial_log_stream_context_t *context);
+//true if the ready buffers of the log only go out once the main loop compressed them
+bool serial_log_stream_is_compressed(serial_log_stream_context_t *context, log_t *log_ptr);
 
 #endif /* SERIAL_LOG_STREAM_H_ */
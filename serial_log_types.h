@@ -11,11 +11,21 @@
 #include <stdint.h>
 #include <serial_log.h>
 
-#define MAX_LOG_STREAM_COUNT    3   //cannot be changed
-#define MAX_LOGS                16  //cannot be changed
-#define MAX_STREAM_DATA_BUFFERS 4
+#define MAX_LOG_STREAM_COUNT    32  //streams of a wide log created from a stream table. Hosts that use protocol v1 only see the first 3
+#define MAX_LOG_ARG_STREAM_COUNT 3  //streams of the logs whose streams are passed as arguments and copied on the stack
+#ifndef MAX_LOGS
+#define MAX_LOGS                16  //up to 254. Hosts that use protocol v1 only see the first 16
+#endif
+#define MAX_STREAM_DATA_BUFFERS 4   //own buffers of a stream
+#define MAX_STREAM_BUFFER_SLOTS 8   //own and borrowed buffers that a stream can hold at once
+#define MAX_POOL_BUFFERS        16  //buffers of the pool of a sample group
 #define MAX_NAME_SIZE           64  //max number of characters used for log names
 #define STORAGE_TIME_IN_MS      1000 //no. of milliseconds for which data is stored before send to the host computer
+#define MAX_STORAGE_TIME_IN_MS  60000 //keeps the buffer size of a log within 32 bits at any sampling rate
+#define MIN_EVENTS_PER_BUFFER   8   //minimum number of change records in a buffer of an event log
+#define MAX_SAMPLE_GROUPS       4   //number of interrupts that can sample logs at their own rate
+#define BIQUAD_FIXED_SHIFT      29  //fractional bits of the fixed point biquad coefficients
+#define STREAM_FIXED_SHIFT      16  //fractional bits of the stream values in the fixed point biquad
 
 
 #define INVALID_LOG_INDEX       -1
@@ -38,6 +48,15 @@ typedef enum log_stream_type_t
     SERIAL_LOG_BOOL_TYPE
 }log_stream_type_t;
 
+typedef enum log_output_mode_t
+{
+    LOG_OUTPUT_CAPTURE = 0,     //triggered captures of the filtered waveform
+    LOG_OUTPUT_STATISTICS,      //continuous per window statistics of the raw value
+    LOG_OUTPUT_SPECTRUM,        //magnitude spectrum of triggered captures computed in the main loop
+    LOG_OUTPUT_EVENT,           //records with a time delta whenever a stream changes beyond its deadband
+    LOG_OUTPUT_BURST            //raw values of every tick stored with plain word stores once triggered
+}log_output_mode_t;
+
 typedef enum log_stream_data_state_t
 {
     SERIAL_LOG_DATA_NOT_SET = 0,
@@ -51,11 +70,12 @@ typedef enum log_stream_data_state_t
 
 typedef enum log_trigger_state_t
 {
-    TRIGGER_WAIT_FOR_NEGATIVE_TRANSITION,
-    TRIGGER_WAIT_FOR_POSITIVE_TRANSITION,
+    TRIGGER_WAIT_FOR_ARM, //waiting for the source to move away from the level against the edge
+    TRIGGER_ARMED,        //waiting for the source to cross the level along the edge
     TRIGGER_ACTIVE,
     TRIGGER_WAIT_FOR_TX_BUFFER_EMPTY,
     TRIGGER_WAIT_FOR_TX_BUFFER_OVFLOW,
+    TRIGGER_WAIT_FOR_SPECTRUM, //capture is complete and the main loop has to compute its spectrum
     TRIGGER_INVALID
 }log_trigger_state_t;
 
@@ -64,35 +84,76 @@ typedef struct log_stream_data_t
     uint32_t *data_ptr; //stream of floating data
     uint32_t data_bits; //if zero then this stream is available for filling
     uint32_t data_offset;//indicate the start index of where this data will be written
+    uint16_t trigger_position; //number of history samples at the head of this buffer. Zero if it has no history
+    uint16_t history_start; //index of the oldest history sample in the circular history at the head of this buffer
+    uint32_t capture_id; //capture that this buffer belongs to
+    uint32_t sample_tick; //sampling tick of the sample group at which the first sample of this buffer was taken
+    uint32_t sample_count; //number of samples in a compressed buffer
+    bool compressed; //the main loop replaced the samples with their xor encoding of serial_log_compress.c
+    uint16_t sequence; //order in which the buffers of a stream started filling so that they are sent in that order
+    uint8_t index; //position in the buffers of the stream
     log_stream_data_state_t state;
 } log_stream_data_t;
 
-typedef struct log_stream_compress_t
+//buffers shared by the streams of a sample group. Only the sampling interrupt of that group lends them out
+//and takes them back, so a group that preempts another never touches its pool
+typedef struct log_buffer_pool_t
 {
-    uint32_t last_log_data;
-    uint8_t last_leading_zero_count;
-    uint8_t last_trailing_zero_count;
-    uint8_t last_meaningful_bit_count;
-} log_stream_compress_t;
+    log_stream_data_t *buffers[MAX_POOL_BUFFERS];
+    uint8_t free_count;
+    uint8_t buffer_count;
+    uint32_t max_bit_count; //streams with larger buffers cannot borrow from the pool
+    log_stream_data_t *returned_buffers[MAX_POOL_BUFFERS]; //buffers of closed logs given back by the main loop
+    volatile uint16_t returned_count; //only written by the main loop
+    uint16_t reclaimed_count; //only written by the sampling side
+} log_buffer_pool_t;
 
 typedef struct log_stream_t
 {
     bool in_use; //indicates if this stream is active or not
     //2 buffers with one acting as the main one and the other acting
     //as the one which is used by the serial code for sending data
-    log_stream_data_t *buffers[MAX_STREAM_DATA_BUFFERS];
+    //own buffers come first and are followed by the ones borrowed from the pool
+    log_stream_data_t *buffers[MAX_STREAM_BUFFER_SLOTS];
 
     log_stream_data_t *active_stream_data_ptr;
+    //free buffers are handed out without scanning. The sampling side takes them from free_buffers and
+    //the transmit side returns them through returned_buffers, which the sampling side moves back when needed
+    uint8_t free_buffers[MAX_STREAM_DATA_BUFFERS];
+    uint8_t free_count;
+    uint8_t reserved_count; //number of own buffers
+    uint8_t borrowed_count; //number of pool buffers held whether they are filling, filled, sent or returned
+    log_buffer_pool_t *pool; //pool of the sample group that the stream belongs to
+    uint8_t returned_buffers[MAX_STREAM_BUFFER_SLOTS];
+    volatile uint16_t returned_count; //only written by the transmit side
+    uint16_t reclaimed_count; //only written by the sampling side
+    uint16_t fill_sequence;
     uint32_t max_bit_count; //this is the maximum number of data bits that is fillable in a single buffer
     uint8_t type_length_in_bits; //number of bits in a single data type
     bool big_endian;
     log_stream_type_t type;
-    log_stream_compress_t compress;
+    log_stream_mode_t mode;
+    uint32_t capture_id; //capture currently being stored by this stream
+    const uint32_t *tick_ptr; //sampling ticks of the sample group of the log
 
     char *name;         //name of the substream
     float *data_ptr;    //pointer to the floating point data that is sampled periodically
     float data_value;   //low pass filtered data value
     float dc_value;     //double low pass filtered to allow a static dc content used for centering the data along the y axis
+    union {
+        float z[2];         //transposed direct form II state of SERIAL_LOG_FILTER_BUTTERWORTH
+        int32_t q[4];       //previous two inputs and outputs of SERIAL_LOG_FILTER_BUTTERWORTH_FIXED
+    } filter_state;
+    float min_value;    //smallest raw value in the current decimation interval for SERIAL_LOG_STREAM_PEAK
+    float max_value;    //largest raw value in the current decimation interval for SERIAL_LOG_STREAM_PEAK
+    float sum;          //sum of the raw values in the current window for SERIAL_LOG_STREAM_STATISTICS and SERIAL_LOG_FILTER_BOXCAR
+    float sum_of_squares;
+    uint16_t window_count; //number of raw values in the current window
+    float deadband;     //change of the raw value that stores a new record for SERIAL_LOG_STREAM_EVENT
+    uint16_t event_delta; //ticks since the previous record of an event stream
+    float *spectrum_ptr; //fft_size samples of a spectrum capture. Replaced by the magnitudes in the main loop
+    log_field_type_t field_type; //type of the struct field that is converted into the data of a struct log
+    uint16_t field_offset; //offset of the field in the snapshot of a struct log
 } log_stream_t;
 
 #define STREAMS(log_ptr) (log_ptr->type.output.streams)
@@ -104,26 +165,77 @@ typedef struct log_input_t
     log_input_handler_t func;
 }log_input_t;
 
+typedef struct log_trigger_t
+{
+    log_trigger_mode_t mode;
+    uint8_t edge;
+    uint8_t source_stream;
+    float level;
+    float hysteresis;
+    float slope;
+    float sign;         //+1 when armed for a rising edge and -1 for a falling edge
+    float last_value;   //source value of the previous tick used for the slope
+    bool force;         //set by the host or the application to fire the trigger once, armed or not
+} log_trigger_t;
+
 typedef struct log_output_t
 {
+    log_output_mode_t mode;
+    uint8_t sample_group; //logs are only sampled by the entry point of their sample group
     uint16_t sample_count; //incremented at each sampling tick
     uint16_t sample_index; //when the number of sample count reaches the sample index, data is written into the output stream
-    uint16_t store_count; //number of data points stored
+    uint32_t store_count; //number of data points stored. Continuous logs keep counting so it is as wide as the data offset of a buffer
+    uint16_t pre_trigger_count; //number of decimated samples kept in the circular history while waiting for a trigger
+    uint16_t history_index; //next position to be written in the circular history
+    bool history_full; //true once the circular history wrapped around at least once
     float lpf; //this is the low pass filtering coefficient for output data
+    log_filter_t filter;
+    float biquad[5]; //b0, b1, b2, a1 and a2 of the butterworth filter at the bandwidth of the log
+    int32_t biquad_fixed[5]; //same coefficients with BIQUAD_FIXED_SHIFT fractional bits
     log_trigger_state_t trigger_state;
+    log_trigger_t trigger;
+    serial_log_trigger_t pending_trigger; //trigger from serial_log_set_trigger that the sampling side has not applied yet
+    volatile uint16_t trigger_set_count; //only written by the main loop. Odd while pending_trigger is being written
+    uint16_t trigger_applied_count; //only written by the sampling side
+    uint32_t capture_id; //incremented on every trigger. Shared by all the logs of a trigger group
+    volatile uint32_t dropped_capture_id; //capture that overflowed, 0 if none. Its ready buffers are released by the main loop instead of being sent
+    uint32_t capture_tick; //sampling tick of the trigger of the current capture
+    struct log_t *group_master; //log whose trigger starts this one. NULL if it triggers by itself
+    struct log_t *group_next; //next member of the trigger group led by this log
+    float *twiddle_ptr; //fft_size/2 complex twiddle factors for LOG_OUTPUT_SPECTRUM
+    uint16_t fft_size;
+    uint16_t bin_count; //number of spectrum bins sent to the host
+    uint16_t dropped_spectra; //spectra that were not sent because a stream had no free buffer
+    const volatile void *struct_ptr; //struct that is copied into the snapshot on every tick. NULL if the streams point to their own data
+    void *snapshot_ptr; //copy of the struct followed by a float for every field that has to be converted
+    uint16_t struct_size;
+    struct log_t *source_log; //log whose filtered values are the inputs of derive_func
+    serial_log_derive_t derive_func; //NULL unless the streams are derived from source_log
+    void *derive_context;
+    float *derived_values; //outputs of derive_func that the streams of a derived log point to
+    float *source_values; //inputs of derive_func copied from the source log. Follows derived_values in the same allocation
+    uint16_t derive_count; //ticks since derive_func was last called
+    uint16_t burst_length; //number of ticks stored by every burst of LOG_OUTPUT_BURST
+    bool burst_ready; //every stream has a buffer for the next burst
+    uint8_t peak_stream_count; //streams that follow the envelope of their raw value on every tick
+    bool compress; //the main loop compresses the ready buffers of the sample streams while the host uses protocol v2
+    uint32_t *compress_ptr; //output of the compression of one buffer. NULL until compression is first enabled
 
     int stream_count;
-    log_stream_t *streams[MAX_LOG_STREAM_COUNT];   //
+    log_stream_t **streams; //stream_count pointers allocated with the log
 } log_output_t;
 
 typedef struct log_t
 {
     log_stream_direction_t direction;
+    log_stream_direction_t closed_direction; //direction before the log was closed so that its memory can be freed
     union {
         log_output_t output;
         log_input_t input;
     } type;
     char *title;
+    bool static_log; //memory comes from a serial_log_static_t and the title and names are plain strings
+    struct serial_log_instance_t *instance; //instance that samples and sends the log
 
 } log_t;
 
@@ -0,0 +1,98 @@
+/*
+ * bench_burst.c
+ *
+ * Measures the sampling tick with no logs, with LOG_COUNT burst logs of 1 stream and with
+ * LOG_COUNT burst logs of 3 streams. The differences give the cost of a stream and of a log.
+ * Every tick is run RUN_COUNT times from a fresh logger and keeps its fastest time. The
+ * figures are host cycles. Only the median tick is split, the slowest tick is a buffer
+ * switch and too noisy on the host to split. On the target the same split is measured by
+ * reading a cpu timer around serial_log_sample_data.
+ *
+ *      Author: RanaBasheer
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "serial_log.h"
+#include "test_port.h"
+
+#define LOG_COUNT       8
+#define TICK_COUNT      4000
+#define RUN_COUNT       25
+#define BURST_LENGTH    256
+
+static uint32_t log_memory[40000];
+static volatile float a, b, c;
+static uint64_t tick_cycles[TICK_COUNT];
+
+static bool run_ticks(int log_count, int stream_count)
+{
+    int i;
+    serial_log_trigger_t trigger = {SERIAL_LOG_TRIGGER_FREE_RUN, SERIAL_LOG_TRIGGER_RISING, 0, 0, 0, 0};
+
+    serial_log_init(log_memory, sizeof(log_memory), 20000);
+    for(i = 0; i < log_count; ++i)
+    {
+        if(serial_log_output_burst("Burst", BURST_LENGTH, &trigger, stream_count, "a", &a, "b", &b, "c", &c) == NULL)
+            return false;
+    }
+    for(i = 0; i < TICK_COUNT; ++i)
+    {
+        uint64_t start;
+        a = (float)i;
+        b = -(float)i;
+        c = (float)(i & 0xFF);
+        start = test_read_cycles();
+        serial_log_sample_data();
+        tick_cycles[i] = test_read_cycles() - start;
+        serial_log_handler(i/20);
+    }
+    return true;
+}
+
+static int compare_cycles(const void *x, const void *y)
+{
+    uint64_t left = *(const uint64_t *)x, right = *(const uint64_t *)y;
+    return (left > right) - (left < right);
+}
+
+/*
+ * gets the median and the slowest of the fastest times of every tick. Returns false if the
+ * logs do not fit
+ */
+static bool measure(int log_count, int stream_count, double *median, double *slowest)
+{
+    static uint64_t fastest[TICK_COUNT];
+    int run, i;
+    for(run = 0; run < RUN_COUNT; ++run)
+    {
+        if(!run_ticks(log_count, stream_count))
+            return false;
+        for(i = 0; i < TICK_COUNT; ++i)
+        {
+            if(run == 0 || tick_cycles[i] < fastest[i])
+                fastest[i] = tick_cycles[i];
+        }
+    }
+    qsort(fastest, TICK_COUNT, sizeof(fastest[0]), compare_cycles);
+    *median = (double)fastest[TICK_COUNT/2];
+    *slowest = (double)fastest[TICK_COUNT - 1];
+    return true;
+}
+
+int main(void)
+{
+    double median[3], slowest[3], per_stream, per_log;
+    if(!measure(0, 0, &median[0], &slowest[0]) || !measure(LOG_COUNT, 1, &median[1], &slowest[1]) ||
+       !measure(LOG_COUNT, 3, &median[2], &slowest[2]))
+    {
+        printf("the logs do not fit in the memory\n");
+        return 1;
+    }
+    per_stream = (median[2] - median[1])/(2*LOG_COUNT);
+    per_log = (median[1] - median[0])/LOG_COUNT - per_stream;
+    printf("%d burst logs, host cycles\n", LOG_COUNT);
+    printf("median tick  no log %6.0f 1 stream %6.0f 3 streams %6.0f\n", median[0], median[1], median[2]);
+    printf("slowest tick no log %6.0f 1 stream %6.0f 3 streams %6.0f\n", slowest[0], slowest[1], slowest[2]);
+    printf("per stream %5.1f per log %5.1f\n", per_stream, per_log);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/*
+ * bench_filter.c
+ *
+ * Compares the sampling tick of a wide capture log with every anti-alias filter. The log
+ * runs at a 20 kHz tick with a 50 Hz bandwidth so most ticks only filter and a few store.
+ * Every tick is run RUN_COUNT times from a fresh logger and keeps its fastest time, then
+ * the mean and the slowest tick are reported in host cycles per stream.
+ *
+ * The host figures only rank the filters. The cost on the target is measured the same way
+ * by reading a cpu timer around serial_log_sample_data.
+ *
+ *      Author: RanaBasheer
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "serial_log.h"
+#include "test_port.h"
+
+#define STREAM_COUNT    16
+#define TICK_COUNT      4000
+#define RUN_COUNT       15
+#define SAMPLING_RATE   20000
+#define BANDWIDTH       50
+
+static uint32_t log_memory[32000];
+static volatile float values[STREAM_COUNT];
+static uint64_t tick_cycles[TICK_COUNT];
+
+static bool run_ticks(log_filter_t filter)
+{
+    int i, j;
+    static const char *names[STREAM_COUNT] = {"a", "b", "c", "d", "e", "f", "g", "h",
+                                              "i", "j", "k", "l", "m", "n", "o", "p"};
+    serial_log_stream_t streams[STREAM_COUNT];
+    serial_log_trigger_t trigger = {SERIAL_LOG_TRIGGER_FREE_RUN, SERIAL_LOG_TRIGGER_RISING, 0, 0, 0, 0};
+    void *log_ptr;
+
+    memset(streams, 0, sizeof(streams));
+    for(j = 0; j < STREAM_COUNT; ++j)
+    {
+        streams[j].name = names[j];
+        streams[j].data_ptr = (float *)&values[j];
+    }
+    serial_log_init(log_memory, sizeof(log_memory), SAMPLING_RATE);
+    log_ptr = serial_log_output_streams("Filter", BANDWIDTH, &trigger, STREAM_COUNT, streams);
+    if(log_ptr == NULL)
+    {
+        return false;
+    }
+    serial_log_set_filter(log_ptr, filter);
+
+    for(i = 0; i < TICK_COUNT; ++i)
+    {
+        uint64_t start;
+        for(j = 0; j < STREAM_COUNT; ++j)
+        {
+            values[j] = 100.0f*sinf(0.002f*(float)(i*(j + 1)));
+        }
+        start = test_read_cycles();
+        serial_log_sample_data();
+        tick_cycles[i] = test_read_cycles() - start;
+        serial_log_handler(i/(SAMPLING_RATE/1000));
+    }
+    return true;
+}
+
+int main(void)
+{
+    static const log_filter_t filters[] = {SERIAL_LOG_FILTER_SINGLE_POLE, SERIAL_LOG_FILTER_BUTTERWORTH,
+                                           SERIAL_LOG_FILTER_BUTTERWORTH_FIXED, SERIAL_LOG_FILTER_BOXCAR};
+    static const char *filter_names[] = {"single pole", "butterworth", "butterworth fixed", "boxcar"};
+    static uint64_t fastest[TICK_COUNT];
+    unsigned int f;
+    int run, i;
+
+    printf("%d streams, %d Hz tick, %d Hz bandwidth, host cycles per stream\n", STREAM_COUNT, SAMPLING_RATE, BANDWIDTH);
+    for(f = 0; f < sizeof(filters)/sizeof(filters[0]); ++f)
+    {
+        uint64_t total = 0, slowest = 0;
+        for(run = 0; run < RUN_COUNT; ++run)
+        {
+            if(!run_ticks(filters[f]))
+            {
+                printf("the log does not fit in the memory\n");
+                return 1;
+            }
+            for(i = 0; i < TICK_COUNT; ++i)
+            {
+                if(run == 0 || tick_cycles[i] < fastest[i])
+                    fastest[i] = tick_cycles[i];
+            }
+        }
+        for(i = 0; i < TICK_COUNT; ++i)
+        {
+            total += fastest[i];
+            if(fastest[i] > slowest)
+                slowest = fastest[i];
+        }
+        printf("%-18s mean %6.1f slowest %6.1f\n", filter_names[f],
+               (double)total/TICK_COUNT/STREAM_COUNT, (double)slowest/STREAM_COUNT);
+    }
+    return 0;
+}
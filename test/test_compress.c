@@ -0,0 +1,177 @@
+/*
+ * test_compress.c
+ *
+ * Compresses known sample sequences with serial_log_compress_buffer and checks that
+ * serial_log_decode_compressed gives back the same bits. Every sequence is also run
+ * with a held tail so that it compresses even when its own values do not get smaller.
+ *
+ *      Author: RanaBasheer
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "serial_log_compress.h"
+#include "serial_log_decode.h"
+#include "test_port.h"
+
+#define MAX_SAMPLE_COUNT    512
+#define HELD_TAIL_COUNT     128
+
+typedef struct test_sequence_t {
+    const char *name;
+    uint32_t sample_count;
+    uint32_t samples[MAX_SAMPLE_COUNT];
+} test_sequence_t;
+
+static test_sequence_t sequence;
+
+static uint32_t float_bits(float value)
+{
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+static void add_bits(uint32_t bits)
+{
+    if(sequence.sample_count < MAX_SAMPLE_COUNT)
+        sequence.samples[sequence.sample_count++] = bits;
+}
+
+static void add_float(float value)
+{
+    add_bits(float_bits(value));
+}
+
+/*
+ * compresses the sequence and decodes it again. Returns false if a sample does not match
+ * bit for bit or if a sequence that has to get smaller did not
+ */
+static bool round_trip(bool must_compress)
+{
+    static uint32_t data[SERIAL_LOG_COMPRESS_BUFFER_WORDS(MAX_SAMPLE_COUNT)];
+    static uint8_t bytes[sizeof(data)];
+    static float samples[MAX_SAMPLE_COUNT];
+    uint32_t i, byte_count;
+    uint32_t bit_count = serial_log_compress_buffer(sequence.samples, sequence.sample_count, data);
+    int count;
+
+    printf("%-24s %4lu samples ", sequence.name, (unsigned long)sequence.sample_count);
+    if(bit_count == 0)
+    {
+        printf("not compressed %s\n", must_compress?"FAILED":"ok");
+        return !must_compress;
+    }
+    //the logger sends the words lsb first
+    byte_count = (bit_count + 7)/8;
+    for(i = 0; i < byte_count; ++i)
+    {
+        bytes[i] = (uint8_t)(data[i/4] >> (8*(i%4)));
+    }
+    count = serial_log_decode_compressed(bytes, byte_count, sequence.sample_count, samples);
+    if(count != (int)sequence.sample_count)
+    {
+        printf("decoded %d samples FAILED\n", count);
+        return false;
+    }
+    for(i = 0; i < sequence.sample_count; ++i)
+    {
+        if(float_bits(samples[i]) != sequence.samples[i])
+        {
+            printf("sample %lu is %08lx instead of %08lx FAILED\n", (unsigned long)i,
+                   (unsigned long)float_bits(samples[i]), (unsigned long)sequence.samples[i]);
+            return false;
+        }
+    }
+    printf("%5lu of %5lu bits ok\n", (unsigned long)bit_count, (unsigned long)sequence.sample_count*32);
+    return true;
+}
+
+/*
+ * runs the sequence as it is and again followed by its last sample held
+ */
+static bool check_sequence(bool must_compress)
+{
+    uint32_t i;
+    bool ok = round_trip(must_compress);
+    uint32_t last = sequence.samples[sequence.sample_count - 1];
+    for(i = 0; i < HELD_TAIL_COUNT; ++i)
+    {
+        add_bits(last);
+    }
+    return round_trip(true) && ok;
+}
+
+static void start_sequence(const char *name)
+{
+    sequence.name = name;
+    sequence.sample_count = 0;
+}
+
+int main(void)
+{
+    int i;
+    bool ok = true;
+    uint32_t random = 0x12345678;
+
+    start_sequence("sine");
+    for(i = 0; i < 256; ++i)
+        add_float(10.0f*sinf(0.05f*i));
+    ok &= check_sequence(false);
+
+    start_sequence("repeated values");
+    for(i = 0; i < 256; ++i)
+        add_float((float)(i/32) - 3.5f);
+    ok &= check_sequence(true);
+
+    start_sequence("single value");
+    add_float(1.0f);
+    ok &= check_sequence(false);
+
+    start_sequence("sign flips");
+    for(i = 0; i < 64; ++i)
+    {
+        add_float((i & 1)?-1.5f:1.5f);
+        add_float((i & 2)?-0.0f:0.0f);
+        add_float((i & 4)?-FLT_MAX:FLT_MAX);
+    }
+    ok &= check_sequence(false);
+
+    start_sequence("nan and infinity");
+    for(i = 0; i < 16; ++i)
+    {
+        add_float(INFINITY);
+        add_float(-INFINITY);
+        add_bits(0x7FC00000); //quiet nan
+        add_bits(0x7FA00001); //signalling nan with a payload
+        add_bits(0xFFFFFFFF); //negative nan with every bit set
+        add_float(NAN);
+        add_bits(0x00000001); //smallest denormal
+        add_float(FLT_MIN);
+    }
+    ok &= check_sequence(false);
+
+    start_sequence("bit windows");
+    for(i = 0; i < 32; ++i)
+    {
+        //a single changed bit at every position, then every bit at once
+        add_bits(0);
+        add_bits(1u << i);
+        add_bits(0xFFFFFFFF);
+        add_bits(0xFFFFFFFF ^ (1u << i));
+    }
+    ok &= check_sequence(false);
+
+    start_sequence("random words");
+    for(i = 0; i < 256; ++i)
+    {
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+        add_bits(random);
+    }
+    ok &= check_sequence(false);
+
+    return ok?0:1;
+}
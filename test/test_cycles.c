@@ -0,0 +1,139 @@
+/*
+ * test_cycles.c
+ *
+ * Checks that the sampling tick takes the same time whatever state the buffers are in.
+ * The logs are first sent out as fast as they fill, then the main loop stops so that
+ * every buffer fills up and the captures overflow, then the main loop drains them again.
+ * The capture is started by hand once the caches are warm and again once it has drained,
+ * so the start of a capture is timed in the free phase as well as after an overflow.
+ *
+ * The host is not quiet enough to trust a single tick, so the same ticks are run
+ * RUN_COUNT times from a fresh logger and every tick keeps its fastest time. The first
+ * WARMUP_TICKS run with cold caches on every run and are left out. The slowest tick of
+ * every phase is compared with the slowest tick of the phase where the buffers are always
+ * free, so a buffer state path that costs more than starting or switching buffers fails.
+ * Other load on the host can still make a single buffer switch slow in all the runs, so
+ * the measurement is repeated up to ATTEMPT_COUNT times and has to pass once. A path that
+ * is really slower fails every attempt.
+ *
+ *      Author: RanaBasheer
+ */
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include "serial_log.h"
+#include "test_port.h"
+
+#define STREAM_COUNT    8
+#define PHASE_TICKS     3000
+#define PHASE_COUNT     3
+#define RUN_COUNT       60
+#define ATTEMPT_COUNT   8
+#define WARMUP_TICKS    100
+#define HANDLER_CALLS   20  //calls of the main loop handler per tick, enough to send the buffers as they fill
+#define MAX_RATIO       1.25 //allowed slowest tick of a phase relative to the free phase
+
+typedef enum test_phase_t {
+    PHASE_FREE = 0,     //the main loop sends the buffers as soon as they are ready
+    PHASE_FULL,         //the main loop is stalled, so the buffers run out and the captures overflow
+    PHASE_DRAIN         //the main loop sends out the buffers that piled up
+} test_phase_t;
+
+static const char *phase_names[PHASE_COUNT] = {"free", "full", "drain"};
+static uint32_t log_memory[16000];
+static volatile float values[STREAM_COUNT];
+static uint64_t tick_cycles[PHASE_COUNT*PHASE_TICKS];
+
+static void run_ticks(void)
+{
+    int i, j;
+    uint32_t tick = 0;
+    static const char *names[STREAM_COUNT] = {"a", "b", "c", "d", "e", "f", "g", "h"};
+    serial_log_stream_t streams[STREAM_COUNT];
+    serial_log_trigger_t trigger = {SERIAL_LOG_TRIGGER_MANUAL, SERIAL_LOG_TRIGGER_RISING, 0, 0, 0, 0};
+    void *capture_ptr;
+
+    memset(streams, 0, sizeof(streams));
+    for(j = 0; j < STREAM_COUNT; ++j)
+    {
+        streams[j].name = names[j];
+        streams[j].data_ptr = (float *)&values[j];
+    }
+    serial_log_init(log_memory, sizeof(log_memory), 1000);
+    capture_ptr = serial_log_output_streams("Capture", 100, &trigger, STREAM_COUNT, streams);
+    serial_log_output("Default", 50, 3, "x", &values[0], "y", &values[1], "z", &values[2]);
+
+    for(i = 0; i < PHASE_COUNT*PHASE_TICKS; ++i, ++tick)
+    {
+        uint64_t start;
+        for(j = 0; j < STREAM_COUNT; ++j)
+        {
+            values[j] = sinf(0.01f*(float)(tick*(j + 1)));
+        }
+        //the drain phase has sent the overflowed capture well before its middle
+        if(i == WARMUP_TICKS || i == PHASE_DRAIN*PHASE_TICKS + PHASE_TICKS/2)
+        {
+            serial_log_force_trigger(capture_ptr);
+        }
+        start = test_read_cycles();
+        serial_log_sample_data();
+        tick_cycles[i] = test_read_cycles() - start;
+        if(i/PHASE_TICKS != PHASE_FULL)
+        {
+            for(j = 0; j < HANDLER_CALLS; ++j)
+            {
+                serial_log_handler(tick);
+            }
+        }
+    }
+}
+
+/*
+ * runs the phases and prints the slowest tick of each. Returns true if none is too slow
+ */
+static bool measure(void)
+{
+    int run, i, phase;
+    static uint64_t fastest[PHASE_COUNT*PHASE_TICKS];
+    uint64_t slowest[PHASE_COUNT];
+    bool passed = true;
+
+    for(run = 0; run < RUN_COUNT; ++run)
+    {
+        run_ticks();
+        for(i = 0; i < PHASE_COUNT*PHASE_TICKS; ++i)
+        {
+            if(run == 0 || tick_cycles[i] < fastest[i])
+                fastest[i] = tick_cycles[i];
+        }
+    }
+    for(phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        slowest[phase] = 0;
+        for(i = (phase == PHASE_FREE)?WARMUP_TICKS:phase*PHASE_TICKS; i < (phase + 1)*PHASE_TICKS; ++i)
+        {
+            if(fastest[i] > slowest[phase])
+                slowest[phase] = fastest[i];
+        }
+    }
+    for(phase = 0; phase < PHASE_COUNT; ++phase)
+    {
+        double ratio = (double)slowest[phase]/(double)slowest[PHASE_FREE];
+        bool ok = ratio <= MAX_RATIO;
+        printf("%-6s slowest tick %6llu cycles %.2f of free %s\n", phase_names[phase],
+               (unsigned long long)slowest[phase], ratio, ok?"ok":"FAILED");
+        passed &= ok;
+    }
+    return passed;
+}
+
+int main(void)
+{
+    int attempt;
+    for(attempt = 0; attempt < ATTEMPT_COUNT; ++attempt)
+    {
+        if(measure())
+            return 0;
+    }
+    return 1;
+}
@@ -0,0 +1,78 @@
+/*
+ * test_port.c
+ *
+ *      Author: RanaBasheer
+ */
+#include <time.h>
+#include "test_port.h"
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+uint32_t test_tx_count;
+
+uint64_t test_read_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec*1000000000u + (uint64_t)now.tv_nsec;
+#endif
+}
+
+//the host has 8 bit bytes
+int SERIAL_LOG_BYTES_TO_BITS(int byte_length)
+{
+    return byte_length << 3;
+}
+
+int SERIAL_LOG_BITS_TO_BYTES(int bit_length)
+{
+    return bit_length >> 3;
+}
+
+void serial_log_store_8bit(void *dest_memory, int byte_index, unsigned char value)
+{
+    ((unsigned char *)dest_memory)[byte_index] = value;
+}
+
+unsigned char serial_log_read_8bit(void *src_memory, int byte_index)
+{
+    return ((unsigned char *)src_memory)[byte_index];
+}
+
+void serial_log_uart_tx(unsigned char data)
+{
+    (void)data;
+    test_tx_count++;
+}
+
+unsigned char serial_log_uart_rx()
+{
+    return 0;
+}
+
+bool is_serial_log_uart_tx_more()
+{
+    return true;
+}
+
+bool is_serial_log_uart_rx_ready()
+{
+    return false;
+}
+
+void serial_log_uart_init()
+{
+}
+
+void serial_log_init_time()
+{
+}
+
+uint32_t serial_log_get_time_ms()
+{
+    return 0;
+}
@@ -0,0 +1,20 @@
+/*
+ * test_port.h
+ *
+ * Host implementation of serial_log_interface.h for the tests. The serial link
+ * accepts every byte and only counts them.
+ *
+ *      Author: RanaBasheer
+ */
+#ifndef TEST_PORT_H_
+#define TEST_PORT_H_
+
+#include <stdint.h>
+#include "serial_log_interface.h"
+
+extern uint32_t test_tx_count; //bytes sent since the start of the test
+
+//reads a free running counter. CPU cycles where the host has one, else nanoseconds
+uint64_t test_read_cycles(void);
+
+#endif /* TEST_PORT_H_ */